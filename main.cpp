@@ -3,13 +3,45 @@
 //  Single-file implementation following the full specification
 // ============================================================
 #include "raylib.h"
+#include "rlgl.h"
 #include <cmath>
 #include <vector>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
-#include <random>
+#include <numeric>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <type_traits>
+
+#if !defined(_WIN32)
+    #include <arpa/inet.h>
+    #include <fcntl.h>
+    #include <netinet/in.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+    #define GX_HAS_UDP 1
+#else
+    #define GX_HAS_UDP 0   // winsock2.h clashes with raylib (CloseWindow, Rectangle, DrawText)
+#endif
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define GX_SOFT_SSE2 1
+#else
+    #define GX_SOFT_SSE2 0
+#endif
 
 // ─────────────────────────────────────────────────────────────
 //  CONSTANTS
@@ -19,6 +51,11 @@ static constexpr int   SH            = 720;
 static constexpr int   WINDOW_SCALE  = 2;
 static constexpr int   FPS_TARGET    = 60;
 
+// Fixed-step simulation: the game always advances in 1/SIM_HZ ticks, no
+// matter the display refresh. Long frames are clamped to avoid a spiral.
+static constexpr int   SIM_HZ_DEFAULT = 120;
+static constexpr float MAX_FRAME_TIME = 0.25f;
+
 // Player
 static constexpr float PLAYER_MAX_SPEED = 320.f;
 static constexpr float PLAYER_ACCEL     = 2400.f;
@@ -28,12 +65,12 @@ static constexpr float BULLET_SPEED  = 520.f;
 static constexpr float BULLET_W      = 3.f;
 static constexpr float BULLET_H      = 12.f;
 
-// Enemies
-static constexpr int   COLS          = 10;
-static constexpr int   ROWS          = 4;
+// Enemies (formation size is in GameTuning; cells shrink to fit big ones)
+static constexpr int   FORM_MAX_COLS = 64;
+static constexpr int   FORM_MAX_ROWS = 64;
 static constexpr float CELL_W        = 44.f;
 static constexpr float CELL_H        = 50.f;
-static constexpr float FORM_START_X  = (SW - COLS * CELL_W) / 2.f;
+static constexpr float FORM_MAX_H    = 320.f;   // vertical room for all rows
 static constexpr float FORM_START_Y  = 80.f;
 static constexpr float FORM_BOB_AMP  = 7.f;
 static constexpr float FORM_BOB_FREQ = 2.2f;
@@ -41,6 +78,7 @@ static constexpr float FORM_ROW_AMP  = 1.0f;
 static constexpr float FORM_ROW_PHASE= 0.55f;
 static constexpr float FORM_COL_AMP  = 3.2f;
 static constexpr float FORM_COL_PHASE= 0.60f;
+static constexpr float FORM_ROW_SKEW = 0.25f;   // column wave phase added per row
 
 // Enemy bullet
 static constexpr float EBULLET_W     = 4.f;
@@ -59,67 +97,431 @@ enum class GameState { ATTRACT, PLAYING, PLAYER_DEAD, GAME_OVER, STAGE_CLEAR };
 enum class EnemyType  { FLAGSHIP, ESCORT, ZAKO_BLUE, ZAKO_BLUE2, ZAKO_GREEN };
 enum class EnemyState { IN_FORMATION, DIVING, RETURNING };
 enum class PowerUpType { FIRE_RATE, DOUBLE_SHOT, TRIPLE_SHOT };
+enum class DeathCause { BULLET, COLLISION, BOSS, COUNT };
+
+// Input for one simulation tick. The simulation never polls the keyboard;
+// main() fills this from raylib (or a headless driver synthesizes it).
+struct InputFrame {
+    bool left  = false;
+    bool right = false;
+    bool fire  = false;   // flanco positivo: pulsado en este tick
+    bool start = false;   // ENTER / SPACE en attract
+};
+
+// ─────────────────────────────────────────────────────────────
+//  RANDOM NUMBERS
+// ─────────────────────────────────────────────────────────────
+// Counter-based generator: draw n of a stream is a pure hash of (key, n),
+// so streams never perturb each other and their whole state is two ints.
+static inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+struct RngStream {
+    uint64_t key     = 0;
+    uint64_t counter = 0;
+
+    uint64_t next() { return mix64(key + (++counter) * 0x9E3779B97F4A7C15ull); }
+
+    // Inclusive range, same contract as raylib's GetRandomValue
+    int range(int lo, int hi) {
+        if (hi < lo) std::swap(lo, hi);
+        uint64_t span = (uint64_t)((int64_t)hi - lo + 1);
+        return lo + (int)(((next() >> 32) * span) >> 32);
+    }
+};
+
+// Per-game random streams. Gameplay decisions and cosmetic effects draw from
+// separate streams, so particle counts or star wraps never change outcomes.
+struct GameRng {
+    enum : uint64_t { GAMEPLAY = 1, COSMETIC = 2, ENTITY = 3, RENDER = 4, POLICY = 5 };
+
+    uint64_t  seed = 0;
+    RngStream gameplay;
+    RngStream cosmetic;
+
+    static uint64_t streamKey(uint64_t seed, uint64_t a, uint64_t b = 0) {
+        return mix64(mix64(seed ^ (a * 0xD6E8FEB86659FD93ull)) + b);
+    }
+
+    void reseed(uint64_t s) {
+        seed     = s;
+        gameplay = {streamKey(s, GAMEPLAY), 0};
+        cosmetic = {streamKey(s, COSMETIC), 0};
+    }
+
+    // Independent stream for one entity event (e.g. the n-th dive of a slot)
+    RngStream entity(uint64_t id, uint64_t n) const {
+        return {streamKey(seed, ENTITY, (id << 20) ^ n), 0};
+    }
+};
+
+// ─────────────────────────────────────────────────────────────
+//  BINARY I/O
+// ─────────────────────────────────────────────────────────────
+// Little-endian byte streams shared by the replay format.
+struct ByteWriter {
+    std::vector<uint8_t>& out;
+
+    void u8(uint8_t v)   { out.push_back(v); }
+    void u16(uint16_t v) { for (int i = 0; i < 2; ++i) out.push_back((uint8_t)(v >> (8 * i))); }
+    void u32(uint32_t v) { for (int i = 0; i < 4; ++i) out.push_back((uint8_t)(v >> (8 * i))); }
+    void u64(uint64_t v) { for (int i = 0; i < 8; ++i) out.push_back((uint8_t)(v >> (8 * i))); }
+    void f32(float v)    { uint32_t u; std::memcpy(&u, &v, 4); u32(u); }
+    void varint(uint64_t v) {
+        while (v >= 0x80) { out.push_back((uint8_t)(v | 0x80)); v >>= 7; }
+        out.push_back((uint8_t)v);
+    }
+};
+
+struct ByteReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool           ok = true;
+
+    bool need(size_t n) {
+        if (!ok || (size_t)(end - p) < n) ok = false;
+        return ok;
+    }
+    uint8_t u8() { return need(1) ? *p++ : 0; }
+    uint16_t u16() { uint16_t v = 0; if (need(2)) for (int i = 0; i < 2; ++i) v |= (uint16_t)(*p++) << (8 * i); return v; }
+    uint32_t u32() { uint32_t v = 0; if (need(4)) for (int i = 0; i < 4; ++i) v |= (uint32_t)(*p++) << (8 * i); return v; }
+    uint64_t u64() { uint64_t v = 0; if (need(8)) for (int i = 0; i < 8; ++i) v |= (uint64_t)(*p++) << (8 * i); return v; }
+    float    f32() { uint32_t u = u32(); float v; std::memcpy(&v, &u, 4); return v; }
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64 && need(1); shift += 7) {
+            uint8_t b = *p++;
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok = false;
+        return 0;
+    }
+};
+
+static bool writeFile(const char* path, const std::vector<uint8_t>& data) {
+    std::FILE* f = std::fopen(path, "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& data) {
+    std::FILE* f = std::fopen(path, "rb");
+    if (!f) return false;
+    data.clear();
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof buf, f)) > 0) data.insert(data.end(), buf, buf + n);
+    bool ok = !std::ferror(f);
+    std::fclose(f);
+    return ok;
+}
+
+// Raw host-format copy of trivially copyable state, used for snapshots.
+// Vectors are stored as a u32 count followed by their elements, so the
+// buffer holds no pointers and can be saved, moved or restored anywhere.
+struct SnapshotWriter {
+    std::vector<uint8_t>& out;
+
+    void raw(const void* data, size_t n) {
+        size_t at = out.size();
+        out.resize(at + n);
+        if (n) std::memcpy(out.data() + at, data, n);
+    }
+    template <class T> void pod(const T& v) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot fields must be POD");
+        raw(&v, sizeof v);
+    }
+    template <class T> void vec(const std::vector<T>& v) {
+        uint32_t n = (uint32_t)v.size();
+        pod(n);
+        raw(v.data(), n * sizeof(T));
+    }
+    bool check(bool) { return true; }
+};
+
+struct SnapshotReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool           ok = true;
+
+    void raw(void* data, size_t n) {
+        if (!ok || (size_t)(end - p) < n) { ok = false; return; }
+        if (n) std::memcpy(data, p, n);
+        p += n;
+    }
+    template <class T> void pod(T& v) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot fields must be POD");
+        raw(&v, sizeof v);
+    }
+    template <class T> void vec(std::vector<T>& v) {
+        uint32_t n = 0;
+        pod(n);
+        if (!ok || (size_t)(end - p) / sizeof(T) < n) { ok = false; return; }
+        v.resize(n);
+        raw(v.data(), n * sizeof(T));
+    }
+    bool check(bool cond) { ok = ok && cond; return ok; }
+};
+
+// Hash por palabras de 32 bits para el estado de cada tick: mucho más barato
+// que FNV byte a byte y suficiente para detectar cualquier divergencia.
+struct StateHasher {
+    uint64_t h = 0x9E3779B97F4A7C15ull;
+
+    void word(uint32_t w) {
+        h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 29;
+    }
+    void f(float v) { uint32_t w; std::memcpy(&w, &v, sizeof w); word(w); }
+    void i(int v)   { word((uint32_t)v); }
+    uint64_t digest() const { return mix64(h); }
+};
+
+// FNV-1a de 64 bits sobre la representación binaria de los campos
+struct Fnv64 {
+    uint64_t h = 1469598103934665603ull;
+
+    void bytes(const void* data, size_t n) {
+        const uint8_t* b = (const uint8_t*)data;
+        for (size_t i = 0; i < n; ++i) { h ^= b[i]; h *= 1099511628211ull; }
+    }
+    template <class T> void add(const T& v) { bytes(&v, sizeof v); }
+};
 
 // ─────────────────────────────────────────────────────────────
 //  STAR FIELD
 // ─────────────────────────────────────────────────────────────
-struct Star {
-    float x, y, speed;
-    float size;
+// Sin estado por estrella: la posición sale de (índice, tiempo) con un hash,
+// así que update() solo avanza el reloj y el número de estrellas no cuesta
+// nada en la simulación. Cada capa baja a su velocidad; al salir por abajo
+// una estrella vuelve arriba con otra x (el hash incluye la vuelta).
+struct StarLayer {
+    int   count;
+    float speed;        // px/s
+    float size;         // lado en px
     unsigned char brightness;
 };
 
-struct StarField {
-    static constexpr int COUNT = 80;
-    Star stars[COUNT];
+// De la más lejana a la más cercana (parallax: lejos = lenta, pequeña, tenue)
+static constexpr StarLayer STAR_LAYERS[] = {
+    {1600,  10.f, 1.f,  60},
+    { 900,  22.f, 1.f, 100},
+    { 360,  50.f, 1.f, 170},
+    { 100, 100.f, 2.f, 255},
+};
+static constexpr int STAR_BLOCK = 64;      // estrellas generadas por tanda
+static constexpr int STAR_WRAPS = 4096;    // vueltas distintas antes de repetir x
+
+// Hash 2D a [0,1) solo con aritmética float ("hash without sine" de Dave
+// Hoskins), para que la versión SIMD haga la misma cuenta por carriles.
+// Entradas positivas: truncar es floor.
+static inline float starFract(float v) { return v - (float)(int)v; }
+
+static inline float starHash(float a, float b) {
+    float x = starFract(a * .1031f), y = starFract(b * .1031f);
+    float d = x * (y + 33.33f) + y * (x + 33.33f) + x * (x + 33.33f);
+    return starFract((x + d + y + d) * (x + d));
+}
 
-    void init() {
-        for (int i = 0; i < COUNT; ++i) {
-            stars[i].x = (float)(GetRandomValue(0, SW));
-            stars[i].y = (float)(GetRandomValue(0, SH));
-            int layer = i % 3;
-            if (layer == 0)      { stars[i].speed = 20.f;  stars[i].size = 1.f; stars[i].brightness = 120; }
-            else if (layer == 1) { stars[i].speed = 50.f;  stars[i].size = 1.f; stars[i].brightness = 180; }
-            else                 { stars[i].speed = 100.f; stars[i].size = 2.f; stars[i].brightness = 255; }
+#if GX_SOFT_SSE2
+static inline __m128 starFract4(__m128 v) { return _mm_sub_ps(v, _mm_cvtepi32_ps(_mm_cvttps_epi32(v))); }
+
+static inline __m128 starHash4(__m128 a, __m128 b) {
+    const __m128 c = _mm_set1_ps(.1031f), o = _mm_set1_ps(33.33f);
+    __m128 x = starFract4(_mm_mul_ps(a, c)), y = starFract4(_mm_mul_ps(b, c));
+    __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_add_ps(y, o)), _mm_mul_ps(y, _mm_add_ps(x, o))),
+                          _mm_mul_ps(x, _mm_add_ps(x, o)));
+    __m128 xd = _mm_add_ps(x, d);
+    return starFract4(_mm_mul_ps(_mm_add_ps(_mm_add_ps(xd, y), d), xd));
+}
+#endif
+#if defined(__AVX__)
+static inline __m256 starFract8(__m256 v) { return _mm256_sub_ps(v, _mm256_cvtepi32_ps(_mm256_cvttps_epi32(v))); }
+
+static inline __m256 starHash8(__m256 a, __m256 b) {
+    const __m256 c = _mm256_set1_ps(.1031f), o = _mm256_set1_ps(33.33f);
+    __m256 x = starFract8(_mm256_mul_ps(a, c)), y = starFract8(_mm256_mul_ps(b, c));
+    __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_add_ps(y, o)), _mm256_mul_ps(y, _mm256_add_ps(x, o))),
+                             _mm256_mul_ps(x, _mm256_add_ps(x, o)));
+    __m256 xd = _mm256_add_ps(x, d);
+    return starFract8(_mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(xd, y), d), xd));
+}
+#endif
+
+// n estrellas con ids id0.. de una capa que ha bajado frac px desde su
+// última vuelta completa (la número wrap). y0 depende solo del id; x del id
+// y de la vuelta en curso.
+static void starPositions(int id0, int n, float frac, float wrap, float salt, float* xs, float* ys) {
+    int i = 0;
+    const float sh = (float)SH, sw = (float)SW;
+#if defined(__AVX__)
+    {
+        const __m256 lane = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+        const __m256 h8 = _mm256_set1_ps(sh), w8 = _mm256_set1_ps(sw), f8 = _mm256_set1_ps(frac);
+        const __m256 sy = _mm256_set1_ps(salt), sx = _mm256_set1_ps(salt + 1.f + wrap);
+        const __m256 xoff = _mm256_set1_ps(0.37f), one = _mm256_set1_ps(1.f);
+        for (; i + 8 <= n; i += 8) {
+            __m256 id = _mm256_add_ps(_mm256_set1_ps((float)(id0 + i)), lane);
+            __m256 y = _mm256_add_ps(_mm256_mul_ps(starHash8(id, sy), h8), f8);
+            __m256 past = _mm256_cmp_ps(y, h8, _CMP_GE_OQ);
+            y = _mm256_sub_ps(y, _mm256_and_ps(past, h8));
+            __m256 k = _mm256_add_ps(sx, _mm256_and_ps(past, one));
+            _mm256_storeu_ps(ys + i, y);
+            _mm256_storeu_ps(xs + i, _mm256_mul_ps(starHash8(_mm256_add_ps(id, xoff), k), w8));
         }
     }
-
-    void update(float dt) {
-        for (auto& s : stars) {
-            s.y += s.speed * dt;
-            if (s.y > SH) { s.y = 0.f; s.x = (float)GetRandomValue(0, SW); }
+#endif
+#if GX_SOFT_SSE2
+    {
+        const __m128 lane = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+        const __m128 h4 = _mm_set1_ps(sh), w4 = _mm_set1_ps(sw), f4 = _mm_set1_ps(frac);
+        const __m128 sy = _mm_set1_ps(salt), sx = _mm_set1_ps(salt + 1.f + wrap);
+        const __m128 xoff = _mm_set1_ps(0.37f), one = _mm_set1_ps(1.f);
+        for (; i + 4 <= n; i += 4) {
+            __m128 id = _mm_add_ps(_mm_set1_ps((float)(id0 + i)), lane);
+            __m128 y = _mm_add_ps(_mm_mul_ps(starHash4(id, sy), h4), f4);
+            __m128 past = _mm_cmpge_ps(y, h4);
+            y = _mm_sub_ps(y, _mm_and_ps(past, h4));
+            __m128 k = _mm_add_ps(sx, _mm_and_ps(past, one));
+            _mm_storeu_ps(ys + i, y);
+            _mm_storeu_ps(xs + i, _mm_mul_ps(starHash4(_mm_add_ps(id, xoff), k), w4));
         }
     }
+#endif
+    for (; i < n; ++i) {
+        float id = (float)(id0 + i);
+        float y = starHash(id, salt) * sh + frac;
+        float k = salt + 1.f + wrap;
+        if (y >= sh) { y -= sh; k += 1.f; }
+        ys[i] = y;
+        xs[i] = starHash(id + 0.37f, k) * sw;
+    }
+}
+
+struct StarField {
+    float  salt = 0.f;   // variante por partida
+    double time = 0.0;   // s; double para que las horas de attract no pierdan precisión
 
-    void draw() const {
-        for (const auto& s : stars) {
-            unsigned char b = s.brightness;
-            DrawRectangle((int)s.x, (int)s.y, (int)s.size, (int)s.size, {b, b, b, 255});
+    void init(RngStream& rng) {
+        salt = (float)rng.range(0, 1023);
+        time = 0.0;
+    }
+
+    void update(float dt) { time += dt; }
+
+    // fn(x, y, capa) por cada estrella, generadas por tandas de STAR_BLOCK
+    template <class Fn> void forEach(Fn&& fn) const {
+        float xs[STAR_BLOCK], ys[STAR_BLOCK];
+        int id0 = 0;
+        for (const StarLayer& layer : STAR_LAYERS) {
+            double scroll = time * layer.speed;
+            double wraps  = std::floor(scroll / SH);
+            float  frac   = (float)(scroll - wraps * SH);
+            float  wrap   = (float)std::fmod(wraps, (double)STAR_WRAPS);
+            for (int i = 0; i < layer.count; i += STAR_BLOCK) {
+                int n = std::min(STAR_BLOCK, layer.count - i);
+                starPositions(id0 + i, n, frac, wrap, salt, xs, ys);
+                for (int j = 0; j < n; ++j) fn(xs[j], ys[j], layer);
+            }
+            id0 += layer.count;
         }
     }
+
+    void draw() const;
 };
 
 // ─────────────────────────────────────────────────────────────
 //  BULLETS
 // ─────────────────────────────────────────────────────────────
+
+// Preallocated dense pool. Live entries are [0, count) so iteration never
+// skips holes; despawning swaps the last entry into the freed slot, and the
+// free list is simply [count, capacity). Nothing allocates after reset().
+// Snapshots reject capacities above POOL_MAX_CAPACITY; flags clamp to it.
+static constexpr int POOL_MAX_CAPACITY = 1 << 16;
+
+template <class T>
+struct FixedPool {
+    std::vector<T> items;
+    int      count    = 0;
+    uint32_t overflow = 0;   // spawns dropped because the pool was full
+
+    int  capacity() const { return (int)items.size(); }
+    int  size() const     { return count; }
+    bool empty() const    { return count == 0; }
+
+    // Empties the pool; reallocates only if the capacity changes
+    void reset(int cap) {
+        if (cap != capacity()) items.assign(std::max(1, cap), T{});
+        count = 0;
+    }
+    void clear() { count = 0; }
+
+    bool push(const T& v) {
+        if (count == capacity()) { ++overflow; return false; }
+        items[count++] = v;
+        return true;
+    }
+    void remove(int i) { items[i] = items[--count]; }
+
+    // fn(entry) may update the entry; returning true despawns it
+    template <class Fn>
+    void removeIf(Fn&& fn) {
+        for (int i = 0; i < count; ) {
+            if (fn(items[i])) remove(i);
+            else ++i;
+        }
+    }
+
+    T&       operator[](int i)       { return items[i]; }
+    const T& operator[](int i) const { return items[i]; }
+    T*       begin()       { return items.data(); }
+    T*       end()         { return items.data() + count; }
+    const T* begin() const { return items.data(); }
+    const T* end()   const { return items.data() + count; }
+
+    // Capacity, count, overflow, then the live slice. A snapshot taken with
+    // a different capacity resizes the pool (restores only, never mid-frame).
+    template <class P, class Ar>
+    static void serialize(P& pool, Ar& ar) {
+        int cap = pool.capacity();
+        ar.pod(cap);
+        ar.pod(pool.count);
+        ar.pod(pool.overflow);
+        if (!ar.check(cap > 0 && cap <= POOL_MAX_CAPACITY && pool.count >= 0 && pool.count <= cap)) {
+            if constexpr (!std::is_const_v<P>) pool.count = 0;
+            return;
+        }
+        if constexpr (!std::is_const_v<P>) {
+            if (cap != pool.capacity()) pool.items.resize(cap);
+        }
+        ar.raw(pool.items.data(), pool.count * sizeof(T));
+    }
+};
+
 struct Bullet {
     float x, y;
     float vx, vy;
-    bool  active = false;
+    float prevX = 0.f, prevY = 0.f;   // posición del tick anterior (interpolación)
     bool  enemy  = false;   // true = enemy bullet
 
-    Rectangle rect() const {
+    Rectangle rect() const { return rectAt(x, y); }
+    Rectangle rectAt(float px, float py) const {
         float w = enemy ? EBULLET_W : BULLET_W;
         float h = enemy ? EBULLET_H : BULLET_H;
-        return { x - w/2, y - h/2, w, h };
+        return { px - w/2, py - h/2, w, h };
     }
 };
 
 struct PowerUp {
-    PowerUpType type;
-    float x, y;
+    PowerUpType type = PowerUpType::FIRE_RATE;
+    float x = 0.f, y = 0.f;
     float vy = 100.f;
-    bool  active = true;
 
     Rectangle rect() const { return {x - 8.f, y - 8.f, 16.f, 16.f}; }
 };
@@ -127,231 +529,301 @@ struct PowerUp {
 // ─────────────────────────────────────────────────────────────
 //  PARTICLES
 // ─────────────────────────────────────────────────────────────
-enum class ParticleType { DOT, SPARK };
-
-struct Particle {
-    float x, y, vx, vy;
-    float life, maxLife;
-    float size;
-    Color color;
-    ParticleType type = ParticleType::DOT;
-    bool  active = false;
-};
+enum class ParticleType : uint8_t { DOT, SPARK };
+
+// Pool capacities. A boss kill with chained hits peaks around 200 particles;
+// anything past capacity is dropped and counted in Effects::overflow.
+static constexpr int FX_MAX_PARTICLES = 1024;
+static constexpr int FX_MAX_FLASHES   = 64;
+static constexpr int FX_MAX_DEBRIS    = 256;
+
+// a[i] += b[i] * k
+static void fxAxpy(float* a, const float* b, float k, int n) {
+    int i = 0;
+#if defined(__AVX__)
+    const __m256 k8 = _mm256_set1_ps(k);
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(a + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_mul_ps(_mm256_loadu_ps(b + i), k8)));
+#endif
+#if GX_SOFT_SSE2
+    const __m128 k4 = _mm_set1_ps(k);
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(a + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_mul_ps(_mm_loadu_ps(b + i), k4)));
+#endif
+    for (; i < n; ++i) a[i] += b[i] * k;
+}
 
-struct Flash {
-    float x, y;
-    float life, maxLife;
-    float radius;
-    bool  active = false;
+// a[i] += k
+static void fxAdd(float* a, float k, int n) {
+    int i = 0;
+#if defined(__AVX__)
+    const __m256 k8 = _mm256_set1_ps(k);
+    for (; i + 8 <= n; i += 8) _mm256_storeu_ps(a + i, _mm256_add_ps(_mm256_loadu_ps(a + i), k8));
+#endif
+#if GX_SOFT_SSE2
+    const __m128 k4 = _mm_set1_ps(k);
+    for (; i + 4 <= n; i += 4) _mm_storeu_ps(a + i, _mm_add_ps(_mm_loadu_ps(a + i), k4));
+#endif
+    for (; i < n; ++i) a[i] += k;
+}
+
+// Fixed-capacity structure-of-arrays pool. Derived lists its columns in
+// columns(self, fn); live entries are [0, count), removal swaps the last
+// one in, and nothing allocates after construction.
+template <class Derived>
+struct FxPool {
+    int      count    = 0;
+    int      capacity = 0;
+
+    // Called from the derived constructor, once its columns exist
+    void allocate(int cap) {
+        capacity = cap;
+        Derived::columns(self(), [cap](auto& col) { col.resize(cap); });
+    }
+
+    Derived&       self()       { return static_cast<Derived&>(*this); }
+    const Derived& self() const { return static_cast<const Derived&>(*this); }
+
+    // Index of a new entry, or -1 when the pool is full
+    int spawn() { return count < capacity ? count++ : -1; }
+
+    void remove(int i) {
+        --count;
+        Derived::columns(self(), [i, last = count](auto& col) { col[i] = col[last]; });
+    }
+
+    // Swap-removes every entry whose life ran out (walks backwards, so the
+    // entry swapped in has already been checked)
+    void expire(const std::vector<float>& life) {
+        for (int i = count - 1; i >= 0; --i)
+            if (life[i] <= 0.f) remove(i);
+    }
+
+    void clear() { count = 0; }
+
+    // Count, then the live slice of each column (same code saves and loads)
+    template <class P, class Ar>
+    static void serialize(P& pool, Ar& ar) {
+        ar.pod(pool.count);
+        if (!ar.check(pool.count >= 0 && pool.count <= pool.capacity)) {
+            if constexpr (!std::is_const_v<P>) pool.count = 0;
+            return;
+        }
+        Derived::columns(pool.self(), [&](auto& col) { ar.raw(col.data(), pool.count * sizeof(col[0])); });
+    }
 };
 
-struct Debris {
-    float x, y, vx, vy;
-    float rot, rotSpeed;   // degrees
-    float life, maxLife;
-    float w, h;
-    Color color;
-    bool  active = false;
+struct ParticlePool : FxPool<ParticlePool> {
+    std::vector<float> x, y, vx, vy, life, maxLife, size;
+    std::vector<Color> color;
+    std::vector<ParticleType> type;
+
+    ParticlePool() { allocate(FX_MAX_PARTICLES); }
+
+    template <class P, class Fn>
+    static void columns(P& p, Fn fn) {
+        fn(p.x); fn(p.y); fn(p.vx); fn(p.vy); fn(p.life); fn(p.maxLife); fn(p.size);
+        fn(p.color); fn(p.type);
+    }
 };
 
-static std::vector<Particle> gParticles;
-static std::vector<Flash>    gFlashes;
-static std::vector<Debris>   gDebris;
-static float                 gShake = 0.f;
-
-void spawnExplosion(float cx, float cy, bool big = false, EnemyType etype = EnemyType::ZAKO_BLUE, bool isPlayer = false) {
-    // Screen shake
-    gShake = std::max(gShake, big ? 7.f : 4.f);
-
-    // Debris fragments (rotando, se desvanecen lento)
-    int dcount = big ? 5 : 2;
-    // Paleta de debris según tipo de enemigo
-    Color debrisColors[4];
-    if (isPlayer) {
-        // Blanco / plateado (jugador)
-        debrisColors[0] = {255, 255, 255, 255};
-        debrisColors[1] = {200, 220, 255, 255};
-        debrisColors[2] = {160, 200, 255, 255};
-        debrisColors[3] = {255, 240, 180, 255};
-    } else if (etype == EnemyType::FLAGSHIP || etype == EnemyType::ESCORT || etype == EnemyType::ZAKO_BLUE2) {
-        // Rojo / naranja (enemy1)
-        debrisColors[0] = {255,  60,  30, 255};
-        debrisColors[1] = {255, 140,  20, 255};
-        debrisColors[2] = {220,  30,  30, 255};
-        debrisColors[3] = {255, 200,  80, 255};
-    } else if (etype == EnemyType::ZAKO_BLUE) {
-        // Verde (enemy2)
-        debrisColors[0] = { 60, 220,  80, 255};
-        debrisColors[1] = {120, 255, 100, 255};
-        debrisColors[2] = { 30, 180,  60, 255};
-        debrisColors[3] = {200, 255, 150, 255};
-    } else {
-        // Lila / violeta (enemy3 ZAKO_GREEN)
-        debrisColors[0] = {180,  80, 255, 255};
-        debrisColors[1] = {220, 140, 255, 255};
-        debrisColors[2] = {130,  50, 200, 255};
-        debrisColors[3] = {255, 180, 255, 255};
-    }
-    for (int i = 0; i < dcount; ++i) {
-        float angle = GetRandomValue(0, 359) * DEG2RAD;
-        float spd   = (float)GetRandomValue(70, big ? 200 : 140);
-        Debris d;
-        d.x = cx + GetRandomValue(-5, 5);
-        d.y = cy + GetRandomValue(-5, 5);
-        d.vx = cosf(angle) * spd;
-        d.vy = sinf(angle) * spd;
-        d.rot      = (float)GetRandomValue(0, 359);
-        d.rotSpeed = (float)GetRandomValue(-480, 480);
-        d.life = d.maxLife = 0.45f + GetRandomValue(0, 35) * 0.01f;
-        d.w = big ? (float)GetRandomValue(6, 11) : (float)GetRandomValue(3, 7);
-        d.h = d.w * 0.45f;
-        d.color = debrisColors[GetRandomValue(0, 3)];
-        d.active = true;
-        gDebris.push_back(d);
-    }
-
-    // Initial bright flash + expanding ring
-    Flash fl;
-    fl.x = cx; fl.y = cy;
-    fl.life = fl.maxLife = 0.18f;
-    fl.radius = big ? 32.f : 22.f;
-    fl.active = true;
-    gFlashes.push_back(fl);
-
-    // Debris particles
-    int count = big ? PARTICLE_COUNT + 8 : PARTICLE_COUNT;
-    for (int i = 0; i < count; ++i) {
-        float angle = (float)i / count * 2.f * PI + GetRandomValue(-8, 8) * 0.06f;
-        float speed = (float)GetRandomValue(55, big ? 210 : 170);
-
-        Particle p;
-        p.x = cx; p.y = cy;
-        p.vx = cosf(angle) * speed;
-        p.vy = sinf(angle) * speed;
-        p.life = p.maxLife = PARTICLE_LIFE * (0.75f + GetRandomValue(0, 50) * 0.005f);
-        p.size = (float)GetRandomValue(2, big ? 6 : 5);
-        p.active = true;
-        p.type = (GetRandomValue(0, 2) == 0) ? ParticleType::SPARK : ParticleType::DOT;
-
-        int roll = GetRandomValue(0, 3);
-        if (isPlayer) {
-            // Blanco / plateado / azul hielo
-            if      (roll == 0) p.color = {255, 255, 255, 255};
-            else if (roll == 1) p.color = {200, 230, 255, 255};
-            else if (roll == 2) p.color = {150, 200, 255, 255};
-            else                p.color = {255, 240, 160, 255};
-        } else if (etype == EnemyType::ZAKO_BLUE) {
-            // Verde
-            if      (roll == 0) p.color = {200, 255, 200, 255};
-            else if (roll == 1) p.color = { 80, 255,  80, 255};
-            else if (roll == 2) p.color = { 30, 200,  60, 255};
-            else                p.color = {160, 255, 100, 255};
-        } else if (etype == EnemyType::ZAKO_GREEN) {
-            // Lila
-            if      (roll == 0) p.color = {240, 200, 255, 255};
-            else if (roll == 1) p.color = {200,  80, 255, 255};
-            else if (roll == 2) p.color = {160,  50, 220, 255};
-            else                p.color = {255, 160, 255, 255};
-        } else {
-            // Rojo / naranja (enemy1, flagship, escort)
-            if      (roll == 0) p.color = {255, 255, 220, 255};
-            else if (roll == 1) p.color = {255, 200,  30, 255};
-            else if (roll == 2) p.color = {255, 100,   0, 255};
-            else                p.color = {255,  40,   0, 255};
-        }
+struct FlashPool : FxPool<FlashPool> {
+    std::vector<float> x, y, life, maxLife, radius;
+
+    FlashPool() { allocate(FX_MAX_FLASHES); }
 
-        gParticles.push_back(p);
+    template <class P, class Fn>
+    static void columns(P& p, Fn fn) {
+        fn(p.x); fn(p.y); fn(p.life); fn(p.maxLife); fn(p.radius);
     }
-}
+};
 
-void updateParticles(float dt) {
-    gShake = std::max(0.f, gShake - dt * 35.f);
+struct DebrisPool : FxPool<DebrisPool> {
+    std::vector<float> x, y, vx, vy;
+    std::vector<float> rot, rotSpeed;   // degrees
+    std::vector<float> life, maxLife, w, h;
+    std::vector<Color> color;
 
-    for (auto& p : gParticles) {
-        if (!p.active) continue;
-        p.x += p.vx * dt;
-        p.y += p.vy * dt;
-        p.life -= dt;
-        if (p.life <= 0.f) p.active = false;
+    DebrisPool() { allocate(FX_MAX_DEBRIS); }
+
+    template <class P, class Fn>
+    static void columns(P& p, Fn fn) {
+        fn(p.x); fn(p.y); fn(p.vx); fn(p.vy); fn(p.rot); fn(p.rotSpeed);
+        fn(p.life); fn(p.maxLife); fn(p.w); fn(p.h); fn(p.color);
     }
-    gParticles.erase(std::remove_if(gParticles.begin(), gParticles.end(),
-        [](const Particle& p){ return !p.active; }), gParticles.end());
+};
 
-    for (auto& f : gFlashes) {
-        if (!f.active) continue;
-        f.life -= dt;
-        if (f.life <= 0.f) f.active = false;
+// Explosion effects owned by the Game (no globals, so several games can
+// coexist in one process and a headless run never touches shared state).
+struct Effects {
+    ParticlePool particles;
+    FlashPool    flashes;
+    DebrisPool   debris;
+    float        shake    = 0.f;
+    uint32_t     overflow = 0;   // spawns dropped because a pool was full
+
+    void clear() {
+        particles.clear();
+        flashes.clear();
+        debris.clear();
+        shake = 0.f;
     }
-    gFlashes.erase(std::remove_if(gFlashes.begin(), gFlashes.end(),
-        [](const Flash& f){ return !f.active; }), gFlashes.end());
 
-    for (auto& d : gDebris) {
-        if (!d.active) continue;
-        d.x   += d.vx * dt;
-        d.y   += d.vy * dt;
-        d.vy  += 90.f * dt;   // gravedad suave
-        d.rot += d.rotSpeed * dt;
-        d.life -= dt;
-        if (d.life <= 0.f) d.active = false;
+    // Resizes the pools and drops every live entry. Gameplay keeps the
+    // FX_MAX_* capacities that snapshotLayoutTag hashes; only --stress
+    // grows them, so its explosions are simulated instead of dropped.
+    void reserve(int particleCap, int flashCap, int debrisCap) {
+        clear();
+        particles.allocate(particleCap);
+        flashes.allocate(flashCap);
+        debris.allocate(debrisCap);
     }
-    gDebris.erase(std::remove_if(gDebris.begin(), gDebris.end(),
-        [](const Debris& d){ return !d.active; }), gDebris.end());
-}
 
-void drawParticles() {
-    BeginBlendMode(BLEND_ADDITIVE);
+    void spawnExplosion(RngStream& rng, float cx, float cy, bool big = false, EnemyType etype = EnemyType::ZAKO_BLUE, bool isPlayer = false) {
+        // Screen shake
+        shake = std::max(shake, big ? 7.f : 4.f);
 
-    // Flash + shockwave ring
-    for (const auto& f : gFlashes) {
-        if (!f.active) continue;
-        float t = f.life / f.maxLife;
-        // Core flash (shrinks slightly)
-        float r = f.radius * (0.9f + t * 0.4f);
-        unsigned char fa = (unsigned char)(t * 230);
-        DrawCircleGradient((int)f.x, (int)f.y, r,
-            {255, 255, 255, fa}, {255, 180, 20, 0});
-        // Expanding ring (grows outward as flash fades)
-        float ringR = f.radius * (1.0f + (1.0f - t) * 2.2f);
-        unsigned char ra = (unsigned char)(t * 160);
-        DrawRing({f.x, f.y}, ringR - 1.5f, ringR + 1.5f, 0, 360, 24,
-            {255, 200, 60, ra});
-    }
-
-    // Debris
-    for (const auto& p : gParticles) {
-        if (!p.active) continue;
-        float t = p.life / p.maxLife;
-        unsigned char alpha = (unsigned char)(t * 255);
-        Color c = {p.color.r, p.color.g, p.color.b, alpha};
-
-        if (p.type == ParticleType::SPARK) {
-            float len = p.size * 5.f * t;
-            float mag = sqrtf(p.vx * p.vx + p.vy * p.vy);
-            if (mag > 0.f) {
-                float nx = p.vx / mag, ny = p.vy / mag;
-                Vector2 tail = {p.x - nx * len, p.y - ny * len};
-                DrawLineEx(tail, {p.x, p.y}, 1.5f, c);
-            }
+        // Debris fragments (rotando, se desvanecen lento)
+        int dcount = big ? 5 : 2;
+        // Paleta de debris según tipo de enemigo
+        Color debrisColors[4];
+        if (isPlayer) {
+            // Blanco / plateado (jugador)
+            debrisColors[0] = {255, 255, 255, 255};
+            debrisColors[1] = {200, 220, 255, 255};
+            debrisColors[2] = {160, 200, 255, 255};
+            debrisColors[3] = {255, 240, 180, 255};
+        } else if (etype == EnemyType::FLAGSHIP || etype == EnemyType::ESCORT || etype == EnemyType::ZAKO_BLUE2) {
+            // Rojo / naranja (enemy1)
+            debrisColors[0] = {255,  60,  30, 255};
+            debrisColors[1] = {255, 140,  20, 255};
+            debrisColors[2] = {220,  30,  30, 255};
+            debrisColors[3] = {255, 200,  80, 255};
+        } else if (etype == EnemyType::ZAKO_BLUE) {
+            // Verde (enemy2)
+            debrisColors[0] = { 60, 220,  80, 255};
+            debrisColors[1] = {120, 255, 100, 255};
+            debrisColors[2] = { 30, 180,  60, 255};
+            debrisColors[3] = {200, 255, 150, 255};
         } else {
-            float sz = p.size * (0.4f + 0.6f * t);
-            DrawCircleGradient((int)p.x, (int)p.y, sz, c,
-                {p.color.r, p.color.g, p.color.b, 0});
+            // Lila / violeta (enemy3 ZAKO_GREEN)
+            debrisColors[0] = {180,  80, 255, 255};
+            debrisColors[1] = {220, 140, 255, 255};
+            debrisColors[2] = {130,  50, 200, 255};
+            debrisColors[3] = {255, 180, 255, 255};
+        }
+        // Random draws happen even when a pool is full, so the cosmetic
+        // stream does not depend on the pool capacities
+        for (int i = 0; i < dcount; ++i) {
+            float angle = rng.range(0, 359) * DEG2RAD;
+            float spd   = (float)rng.range(70, big ? 200 : 140);
+            float dx    = cx + rng.range(-5, 5);
+            float dy    = cy + rng.range(-5, 5);
+            float rot      = (float)rng.range(0, 359);
+            float rotSpeed = (float)rng.range(-480, 480);
+            float life  = 0.45f + rng.range(0, 35) * 0.01f;
+            float w     = big ? (float)rng.range(6, 11) : (float)rng.range(3, 7);
+            Color color = debrisColors[rng.range(0, 3)];
+            int k = debris.spawn();
+            if (k < 0) { ++overflow; continue; }
+            debris.x[k] = dx;
+            debris.y[k] = dy;
+            debris.vx[k] = cosf(angle) * spd;
+            debris.vy[k] = sinf(angle) * spd;
+            debris.rot[k]      = rot;
+            debris.rotSpeed[k] = rotSpeed;
+            debris.life[k] = debris.maxLife[k] = life;
+            debris.w[k] = w;
+            debris.h[k] = w * 0.45f;
+            debris.color[k] = color;
         }
-    }
 
-    EndBlendMode();
+        // Initial bright flash + expanding ring
+        int f = flashes.spawn();
+        if (f >= 0) {
+            flashes.x[f] = cx; flashes.y[f] = cy;
+            flashes.life[f] = flashes.maxLife[f] = 0.18f;
+            flashes.radius[f] = big ? 32.f : 22.f;
+        } else {
+            ++overflow;
+        }
 
-    // Debris fragments – blend normal, sólidos
-    for (const auto& d : gDebris) {
-        if (!d.active) continue;
-        float t = d.life / d.maxLife;
-        unsigned char alpha = (unsigned char)(t * 230);
-        Color c = {d.color.r, d.color.g, d.color.b, alpha};
-        Rectangle rect = {d.x, d.y, d.w, d.h};
-        Vector2 origin = {d.w * 0.5f, d.h * 0.5f};
-        DrawRectanglePro(rect, origin, d.rot, c);
+        // Debris particles
+        int count = big ? PARTICLE_COUNT + 8 : PARTICLE_COUNT;
+        for (int i = 0; i < count; ++i) {
+            float angle = (float)i / count * 2.f * PI + rng.range(-8, 8) * 0.06f;
+            float speed = (float)rng.range(55, big ? 210 : 170);
+
+            float life = PARTICLE_LIFE * (0.75f + rng.range(0, 50) * 0.005f);
+            float size = (float)rng.range(2, big ? 6 : 5);
+            ParticleType type = (rng.range(0, 2) == 0) ? ParticleType::SPARK : ParticleType::DOT;
+
+            Color color;
+            int roll = rng.range(0, 3);
+            if (isPlayer) {
+                // Blanco / plateado / azul hielo
+                if      (roll == 0) color = {255, 255, 255, 255};
+                else if (roll == 1) color = {200, 230, 255, 255};
+                else if (roll == 2) color = {150, 200, 255, 255};
+                else                color = {255, 240, 160, 255};
+            } else if (etype == EnemyType::ZAKO_BLUE) {
+                // Verde
+                if      (roll == 0) color = {200, 255, 200, 255};
+                else if (roll == 1) color = { 80, 255,  80, 255};
+                else if (roll == 2) color = { 30, 200,  60, 255};
+                else                color = {160, 255, 100, 255};
+            } else if (etype == EnemyType::ZAKO_GREEN) {
+                // Lila
+                if      (roll == 0) color = {240, 200, 255, 255};
+                else if (roll == 1) color = {200,  80, 255, 255};
+                else if (roll == 2) color = {160,  50, 220, 255};
+                else                color = {255, 160, 255, 255};
+            } else {
+                // Rojo / naranja (enemy1, flagship, escort)
+                if      (roll == 0) color = {255, 255, 220, 255};
+                else if (roll == 1) color = {255, 200,  30, 255};
+                else if (roll == 2) color = {255, 100,   0, 255};
+                else                color = {255,  40,   0, 255};
+            }
+
+            int k = particles.spawn();
+            if (k < 0) { ++overflow; continue; }
+            particles.x[k] = cx;
+            particles.y[k] = cy;
+            particles.vx[k] = cosf(angle) * speed;
+            particles.vy[k] = sinf(angle) * speed;
+            particles.life[k] = particles.maxLife[k] = life;
+            particles.size[k] = size;
+            particles.type[k] = type;
+            particles.color[k] = color;
+        }
+    }
+
+    // Integrate, age and expire every pool: one vector pass per column
+    void update(float dt) {
+        shake = std::max(0.f, shake - dt * 35.f);
+
+        ParticlePool& p = particles;
+        fxAxpy(p.x.data(), p.vx.data(), dt, p.count);
+        fxAxpy(p.y.data(), p.vy.data(), dt, p.count);
+        fxAdd(p.life.data(), -dt, p.count);
+        p.expire(p.life);
+
+        fxAdd(flashes.life.data(), -dt, flashes.count);
+        flashes.expire(flashes.life);
+
+        DebrisPool& d = debris;
+        fxAxpy(d.x.data(), d.vx.data(), dt, d.count);
+        fxAxpy(d.y.data(), d.vy.data(), dt, d.count);
+        fxAdd(d.vy.data(), 90.f * dt, d.count);   // gravedad suave
+        fxAxpy(d.rot.data(), d.rotSpeed.data(), dt, d.count);
+        fxAdd(d.life.data(), -dt, d.count);
+        d.expire(d.life);
     }
-}
+
+    // Textured quads from the sprite atlas; defined after SpriteAssets
+    void draw() const;
+};
 
 // ─────────────────────────────────────────────────────────────
 //  IMAGE SPRITES
@@ -360,24 +832,66 @@ static constexpr float PLAYER_DRAW_SIZE = 64.f;
 static constexpr float ENEMY_DRAW_SIZE  = 38.f;
 static constexpr float LIFE_ICON_SIZE   = 16.f;
 
-struct SpriteAssets {
-    Texture2D player = {};
-    Texture2D playerLife = {};
-    Texture2D playerBody = {};
-    Texture2D playerThrusters = {};
-    Texture2D enemy1Anim[3] = {};   // 3 frames de animación del cangrejo
-    Texture2D enemy2Anim[6] = {};   // 6 frames ping-pong del Alien1
-    Texture2D enemy3Anim[3] = {};   // 3 frames ping-pong de la Nave1
-    bool loaded = false;
+// Lista de sprites del juego, compartida por el backend GL (Texture2D) y el
+// rasterizador por software (SoftSprite): `get(path, size, trim)` crea cada uno.
+template<class T>
+struct SpriteSet {
+    T player = {};
+    T playerLife = {};
+    T playerBody = {};
+    T playerThrusters = {};
+    T enemy1Anim[3] = {};   // 3 frames de animación del cangrejo
+    T enemy2Anim[6] = {};   // 6 frames ping-pong del Alien1
+    T enemy3Anim[3] = {};   // 3 frames ping-pong de la Nave1
+
+    template<class Get>
+    void loadWith(Get get) {
+        player = get("sprites_new/player1.png", (int)PLAYER_DRAW_SIZE, true);
+        playerLife = get("sprites_new/player1.png", (int)LIFE_ICON_SIZE, true);
+        playerBody       = get("sprites_new/Player1SP.png",          (int)PLAYER_DRAW_SIZE, false);
+        playerThrusters  = get("sprites_new/Player1Propulsores.png", (int)PLAYER_DRAW_SIZE, false);
+        enemy1Anim[0] = get("sprites_new/enemy1_f01.png", (int)ENEMY_DRAW_SIZE, true);
+        enemy1Anim[1] = get("sprites_new/enemy1_f02.png", (int)ENEMY_DRAW_SIZE, true);
+        enemy1Anim[2] = get("sprites_new/enemy1_f03.png", (int)ENEMY_DRAW_SIZE, true);
+        enemy2Anim[0] = get("sprites_new/enemy2_f01.png", (int)ENEMY_DRAW_SIZE, true);
+        enemy2Anim[1] = get("sprites_new/enemy2_f02.png", (int)ENEMY_DRAW_SIZE, true);
+        enemy2Anim[2] = get("sprites_new/enemy2_f03.png", (int)ENEMY_DRAW_SIZE, true);
+        enemy2Anim[3] = get("sprites_new/enemy2_f04.png", (int)ENEMY_DRAW_SIZE, true);
+        enemy2Anim[4] = get("sprites_new/enemy2_f05.png", (int)ENEMY_DRAW_SIZE, true);
+        enemy2Anim[5] = get("sprites_new/enemy2_f06.png", (int)ENEMY_DRAW_SIZE, true);
+        enemy3Anim[0] = get("sprites_new/enemy3_f01.png", (int)ENEMY_DRAW_SIZE, true);
+        enemy3Anim[1] = get("sprites_new/enemy3_f02.png", (int)ENEMY_DRAW_SIZE, true);
+        enemy3Anim[2] = get("sprites_new/enemy3_f03.png", (int)ENEMY_DRAW_SIZE, true);
+    }
 
-    // Carga sin recortar canvas (para sprites compuestos que deben alinearse)
-    // Elimina píxeles marcadores rojo/verde y escala a outputSize x outputSize
-    static Texture2D loadNoTrimTexture(const char* path, int outputSize) {
-        Image img = LoadImage(path);
-        if (img.data == nullptr) {
-            TraceLog(LOG_ERROR, "No se pudo cargar sprite: %s", path);
-            return {};
-        }
+    template<class Fn>
+    void forEach(Fn fn) {
+        fn(player); fn(playerLife); fn(playerBody); fn(playerThrusters);
+        for (auto& t : enemy1Anim) fn(t);
+        for (auto& t : enemy2Anim) fn(t);
+        for (auto& t : enemy3Anim) fn(t);
+    }
+
+    // Frame de enemigo: set 1..3 = enemy1Anim/enemy2Anim/enemy3Anim
+    const T& enemyFrame(int set, int index) const {
+        if (set == 1) return enemy1Anim[index];
+        if (set == 2) return enemy2Anim[index];
+        return enemy3Anim[index];
+    }
+};
+
+// Carga la imagen de un sprite en CPU (RGBA8), escalada a outputSize x outputSize.
+// trim: recorta el canvas transparente; sin trim (sprites compuestos que deben
+// alinearse) se conserva el canvas y se eliminan los píxeles marcadores rojo/verde.
+static Image loadSpriteImage(const char* path, int outputSize, bool trim) {
+    Image img = LoadImage(path);
+    if (img.data == nullptr) {
+        TraceLog(LOG_ERROR, "No se pudo cargar sprite: %s", path);
+        return {};
+    }
+    if (trim) {
+        ImageAlphaCrop(&img, 0.01f);
+    } else {
         ImageFormat(&img, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
         Color* pixels = (Color*)img.data;
         int total = img.width * img.height;
@@ -386,91 +900,259 @@ struct SpriteAssets {
             if (c.r == 255 && c.g == 0 && c.b == 0 && c.a > 128) c = BLANK;
             if (c.r == 0   && c.g == 255 && c.b == 0 && c.a > 128) c = BLANK;
         }
-        if (outputSize > 0) {
-            float fit = std::min((float)outputSize / img.width, (float)outputSize / img.height);
-            int scaledW = std::max(1, (int)std::round((float)img.width * fit));
-            int scaledH = std::max(1, (int)std::round((float)img.height * fit));
-            if (img.width != scaledW || img.height != scaledH)
-                ImageResize(&img, scaledW, scaledH);
-            Image canvas = GenImageColor(outputSize, outputSize, BLANK);
-            Rectangle srcRect = {0.f, 0.f, (float)img.width, (float)img.height};
-            Rectangle dstRect = {
-                (float)((outputSize - img.width) / 2),
-                (float)((outputSize - img.height) / 2),
-                (float)img.width, (float)img.height
-            };
-            ImageDraw(&canvas, img, srcRect, dstRect, WHITE);
-            UnloadImage(img);
-            img = canvas;
-        }
-        Texture2D tex = LoadTextureFromImage(img);
-        if (tex.id != 0) SetTextureFilter(tex, TEXTURE_FILTER_POINT);
+    }
+    if (outputSize > 0) {
+        float fit = std::min((float)outputSize / img.width, (float)outputSize / img.height);
+        int scaledW = std::max(1, (int)std::round((float)img.width * fit));
+        int scaledH = std::max(1, (int)std::round((float)img.height * fit));
+        if (img.width != scaledW || img.height != scaledH)
+            ImageResize(&img, scaledW, scaledH);
+        Image canvas = GenImageColor(outputSize, outputSize, BLANK);
+        Rectangle srcRect = {0.f, 0.f, (float)img.width, (float)img.height};
+        Rectangle dstRect = {
+            (float)((outputSize - img.width) / 2),
+            (float)((outputSize - img.height) / 2),
+            (float)img.width, (float)img.height
+        };
+        ImageDraw(&canvas, img, srcRect, dstRect, WHITE);
         UnloadImage(img);
-        return tex;
+        img = canvas;
     }
+    return img;
+}
 
-    static Texture2D loadTrimmedTexture(const char* path, int outputSize) {
-        Image img = LoadImage(path);
-        if (img.data == nullptr) {
-            TraceLog(LOG_ERROR, "No se pudo cargar sprite: %s", path);
-            return {};
-        }
-        ImageAlphaCrop(&img, 0.01f);
-        if (outputSize > 0) {
-            float fit = std::min((float)outputSize / img.width, (float)outputSize / img.height);
-            int scaledW = std::max(1, (int)std::round((float)img.width * fit));
-            int scaledH = std::max(1, (int)std::round((float)img.height * fit));
-            if (img.width != scaledW || img.height != scaledH) {
-                ImageResize(&img, scaledW, scaledH);
+// Sprite dentro del atlas: su rectángulo de origen (ancho 0 = no cargado)
+struct AtlasSprite {
+    Rectangle src = {};
+    bool valid() const { return src.width > 0.f; }
+};
+
+// Aspecto de una bala: halo radial más núcleo con degradado vertical
+struct BulletLook {
+    float w, h;              // núcleo
+    float glowR, glowDy;     // radio del halo y su desplazamiento vertical
+    Color glowIn, glowOut, coreTop, coreBottom;
+};
+
+static constexpr BulletLook PLAYER_BULLET_LOOK = {
+    BULLET_W, BULLET_H, BULLET_W * 3.f, -BULLET_H * 0.3f,
+    {255, 255, 180, 70}, {255, 255, 80, 0}, {255, 255, 255, 255}, {255, 210, 30, 200}
+};
+static constexpr BulletLook ENEMY_BULLET_LOOK = {
+    EBULLET_W, EBULLET_H, EBULLET_W * 3.f, EBULLET_H * 0.3f,
+    {255, 60, 0, 80}, {255, 30, 0, 0}, {255, 180, 40, 200}, {255, 30, 0, 255}
+};
+
+// Hornea halo + núcleo en una imagen para dibujar en modo aditivo: cada
+// texel guarda la suma rgb*alpha de ambas capas con alpha 255, lo mismo que
+// sumaban al framebuffer el círculo degradado y el rectángulo por separado.
+// anchor: posición del centro de la bala dentro de la imagen.
+static Image bakeBulletGlow(const BulletLook& lk, Vector2& anchor) {
+    int left   = (int)std::floor(-lk.glowR);
+    int top    = (int)std::floor(std::min(lk.glowDy - lk.glowR, -lk.h / 2.f));
+    int right  = (int)std::ceil(lk.glowR);
+    int bottom = (int)std::ceil(std::max(lk.glowDy + lk.glowR, lk.h / 2.f));
+    Image img = GenImageColor(right - left, bottom - top, BLANK);
+    anchor = {(float)-left, (float)-top};
+    if (img.data == nullptr) return img;
+
+    auto mix = [](Color a, Color b, float t, float out[3]) {
+        float al = (a.a + (b.a - a.a) * t) / 255.f;
+        out[0] = (a.r + (b.r - a.r) * t) * al;
+        out[1] = (a.g + (b.g - a.g) * t) * al;
+        out[2] = (a.b + (b.b - a.b) * t) * al;
+    };
+    Color* px = (Color*)img.data;
+    for (int j = 0; j < img.height; ++j) {
+        for (int i = 0; i < img.width; ++i) {
+            float x = left + i + 0.5f, y = top + j + 0.5f;
+            float sum[3] = {0.f, 0.f, 0.f}, c[3];
+            float d = std::hypot(x, y - lk.glowDy);
+            if (d < lk.glowR) {
+                mix(lk.glowIn, lk.glowOut, d / lk.glowR, c);
+                for (int k = 0; k < 3; ++k) sum[k] += c[k];
             }
+            if (x >= -lk.w / 2.f && x < lk.w / 2.f && y >= -lk.h / 2.f && y < lk.h / 2.f) {
+                mix(lk.coreTop, lk.coreBottom, (y + lk.h / 2.f) / lk.h, c);
+                for (int k = 0; k < 3; ++k) sum[k] += c[k];
+            }
+            if (sum[0] + sum[1] + sum[2] <= 0.f) continue;
+            px[j * img.width + i] = {(unsigned char)std::min(sum[0], 255.f), (unsigned char)std::min(sum[1], 255.f),
+                                     (unsigned char)std::min(sum[2], 255.f), 255};
+        }
+    }
+    return img;
+}
 
-            Image canvas = GenImageColor(outputSize, outputSize, BLANK);
-            Rectangle srcRect = {0.f, 0.f, (float)img.width, (float)img.height};
-            Rectangle dstRect = {
-                (float)((outputSize - img.width) / 2),
-                (float)((outputSize - img.height) / 2),
-                (float)img.width,
-                (float)img.height
-            };
-            ImageDraw(&canvas, img, srcRect, dstRect, WHITE);
-            UnloadImage(img);
-            img = canvas;
-        }
-        Texture2D tex = LoadTextureFromImage(img);
-        if (tex.id != 0) SetTextureFilter(tex, TEXTURE_FILTER_POINT);
-        UnloadImage(img);
-        return tex;
+// Degradado radial: color inner en el centro a outer en el borde (radio r),
+// como DrawCircleGradient. Con tinte blanco y alpha a reproduce esa llamada.
+static Image bakeRadial(int r, Color inner, Color outer) {
+    Image img = GenImageColor(2 * r, 2 * r, BLANK);
+    if (img.data == nullptr) return img;
+    Color* px = (Color*)img.data;
+    for (int j = 0; j < 2 * r; ++j) {
+        for (int i = 0; i < 2 * r; ++i) {
+            float t = std::hypot(i + 0.5f - r, j + 0.5f - r) / r;
+            if (t >= 1.f) continue;
+            px[j * 2 * r + i] = {(unsigned char)(inner.r + (outer.r - inner.r) * t),
+                                 (unsigned char)(inner.g + (outer.g - inner.g) * t),
+                                 (unsigned char)(inner.b + (outer.b - inner.b) * t),
+                                 (unsigned char)(inner.a + (outer.a - inner.a) * t)};
+        }
+    }
+    return img;
+}
+
+// Anillo blanco de radio r y grosor 2*halfW, con borde suavizado
+static Image bakeRing(float r, float halfW) {
+    int size = 2 * (int)std::ceil(r + halfW + 1.f);
+    Image img = GenImageColor(size, size, BLANK);
+    if (img.data == nullptr) return img;
+    Color* px = (Color*)img.data;
+    for (int j = 0; j < size; ++j) {
+        for (int i = 0; i < size; ++i) {
+            float d = std::hypot(i + 0.5f - size / 2.f, j + 0.5f - size / 2.f);
+            float cover = std::clamp(halfW + 0.5f - std::fabs(d - r), 0.f, 1.f);
+            if (cover > 0.f) px[j * size + i] = {255, 255, 255, (unsigned char)(cover * 255.f)};
+        }
+    }
+    return img;
+}
+
+// Chispa: trazo blanco a lo largo de u, bordes suaves a lo ancho (v)
+static Image bakeSpark() {
+    static const unsigned char rows[4] = {110, 255, 255, 110};
+    Image img = GenImageColor(8, 4, BLANK);
+    if (img.data == nullptr) return img;
+    Color* px = (Color*)img.data;
+    for (int j = 0; j < 4; ++j)
+        for (int i = 0; i < 8; ++i) px[j * 8 + i] = {255, 255, 255, rows[j]};
+    return img;
+}
+
+// Radios de referencia de los anillos horneados (razón ~sqrt 2): se usa el
+// más cercano, así el grosor de 3 px varía como mucho un ~20 %
+static constexpr float FX_RING_RADII[5] = {24.f, 34.f, 48.f, 68.f, 96.f};
+static constexpr float FX_RING_HALF_W   = 1.5f;
+
+// Tamaños de las cifras del HUD, horneadas con la fuente por defecto
+static constexpr int HUD_DIGIT_SIZES[2] = {14, 20};
+
+// Todos los sprites en una sola textura, así la formación, el jefe, la nave
+// y el HUD se dibujan sin cambiar de textura (un solo lote de raylib). Las
+// primitivas también usan el atlas vía SetShapesTexture (bloque blanco).
+struct SpriteAssets : SpriteSet<AtlasSprite> {
+    static constexpr int ATLAS_W   = 256;
+    static constexpr int ATLAS_PAD = 2;   // borde replicado: sin sangrado al rotar o escalar
+    static constexpr int WHITE_BOX = 4;
+
+    Texture2D atlas = {};
+    bool loaded = false;
+
+    // Texturas horneadas al cargar (solo backend GL; el rasterizador por
+    // software dibuja las suyas): balas, efectos y el bloque blanco
+    AtlasSprite pBullet, eBullet;
+    Vector2     pBulletAnchor = {}, eBulletAnchor = {};
+    AtlasSprite fxDot, fxFlash, fxSpark;
+    AtlasSprite fxRing[5];
+    AtlasSprite digit[2][10];            // 0-9 a cada HUD_DIGIT_SIZES
+    float       digitAdvance[2][10] = {};  // avance de DrawText: ancho + espaciado
+    AtlasSprite white;   // interior del bloque: primitivas y restos
+
+    template<class Fn>
+    void forEachBaked(Fn fn) {
+        fn(pBullet); fn(eBullet); fn(fxDot); fn(fxFlash); fn(fxSpark);
+        for (auto& r : fxRing) fn(r);
+        for (auto& size : digit) for (auto& d : size) fn(d);
+        fn(white);
+    }
+
+    // Copia src en dst (RGBA8) en (x, y), replicando su borde en el margen
+    static void blitPadded(Image& dst, const Image& src, int x, int y) {
+        Color*       d = (Color*)dst.data;
+        const Color* p = (const Color*)src.data;
+        for (int j = -ATLAS_PAD; j < src.height + ATLAS_PAD; ++j) {
+            int sy = std::clamp(j, 0, src.height - 1);
+            for (int i = -ATLAS_PAD; i < src.width + ATLAS_PAD; ++i) {
+                int sx = std::clamp(i, 0, src.width - 1);
+                d[(y + j) * dst.width + (x + i)] = p[sy * src.width + sx];
+            }
+        }
     }
 
     void load() {
-        player = loadTrimmedTexture("sprites_new/player1.png", (int)PLAYER_DRAW_SIZE);
-        playerLife = loadTrimmedTexture("sprites_new/player1.png", (int)LIFE_ICON_SIZE);
-        playerBody       = loadNoTrimTexture("sprites_new/Player1SP.png",          (int)PLAYER_DRAW_SIZE);
-        playerThrusters  = loadNoTrimTexture("sprites_new/Player1Propulsores.png", (int)PLAYER_DRAW_SIZE);
-        enemy1Anim[0] = loadTrimmedTexture("sprites_new/enemy1_f01.png", (int)ENEMY_DRAW_SIZE);
-        enemy1Anim[1] = loadTrimmedTexture("sprites_new/enemy1_f02.png", (int)ENEMY_DRAW_SIZE);
-        enemy1Anim[2] = loadTrimmedTexture("sprites_new/enemy1_f03.png", (int)ENEMY_DRAW_SIZE);
-        enemy2Anim[0] = loadTrimmedTexture("sprites_new/enemy2_f01.png", (int)ENEMY_DRAW_SIZE);
-        enemy2Anim[1] = loadTrimmedTexture("sprites_new/enemy2_f02.png", (int)ENEMY_DRAW_SIZE);
-        enemy2Anim[2] = loadTrimmedTexture("sprites_new/enemy2_f03.png", (int)ENEMY_DRAW_SIZE);
-        enemy2Anim[3] = loadTrimmedTexture("sprites_new/enemy2_f04.png", (int)ENEMY_DRAW_SIZE);
-        enemy2Anim[4] = loadTrimmedTexture("sprites_new/enemy2_f05.png", (int)ENEMY_DRAW_SIZE);
-        enemy2Anim[5] = loadTrimmedTexture("sprites_new/enemy2_f06.png", (int)ENEMY_DRAW_SIZE);
-        enemy3Anim[0] = loadTrimmedTexture("sprites_new/enemy3_f01.png", (int)ENEMY_DRAW_SIZE);
-        enemy3Anim[1] = loadTrimmedTexture("sprites_new/enemy3_f02.png", (int)ENEMY_DRAW_SIZE);
-        enemy3Anim[2] = loadTrimmedTexture("sprites_new/enemy3_f03.png", (int)ENEMY_DRAW_SIZE);
-        loaded = player.id != 0 && playerLife.id != 0 &&
-                 enemy1Anim[0].id != 0 && enemy2Anim[0].id != 0 && enemy3Anim[0].id != 0;
+        SpriteSet<Image> images;
+        images.loadWith(loadSpriteImage);
+        std::vector<Image*>       src;
+        std::vector<AtlasSprite*> dst;
+        images.forEach([&](Image& img) { src.push_back(&img); });
+        forEach([&](AtlasSprite& sp) { dst.push_back(&sp); });
+
+        // Mismo orden que forEachBaked
+        std::vector<Image> baked;
+        baked.push_back(bakeBulletGlow(PLAYER_BULLET_LOOK, pBulletAnchor));
+        baked.push_back(bakeBulletGlow(ENEMY_BULLET_LOOK, eBulletAnchor));
+        baked.push_back(bakeRadial(8, WHITE, {255, 255, 255, 0}));
+        baked.push_back(bakeRadial(32, WHITE, {255, 180, 20, 0}));
+        baked.push_back(bakeSpark());
+        for (float r : FX_RING_RADII) baked.push_back(bakeRing(r, FX_RING_HALF_W));
+        for (int k = 0; k < 2; ++k) {
+            for (int d = 0; d < 10; ++d) {
+                const char txt[2] = {(char)('0' + d), '\0'};
+                baked.push_back(ImageText(txt, HUD_DIGIT_SIZES[k], WHITE));
+                digitAdvance[k][d] = (float)(MeasureText(txt, HUD_DIGIT_SIZES[k]) + HUD_DIGIT_SIZES[k] / 10);
+            }
+        }
+        baked.push_back(GenImageColor(WHITE_BOX, WHITE_BOX, WHITE));
+        for (Image& img : baked) src.push_back(&img);
+        forEachBaked([&](AtlasSprite& sp) { dst.push_back(&sp); });
+
+        // Estanterías, de más alto a más bajo
+        std::vector<int> order(src.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return src[a]->height > src[b]->height; });
+        std::vector<Vector2> at(src.size());
+        int x = 0, y = 0, shelfH = 0;
+        for (int k : order) {
+            if (src[k]->data == nullptr) continue;
+            ImageFormat(src[k], PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+            int w = src[k]->width + 2 * ATLAS_PAD, h = src[k]->height + 2 * ATLAS_PAD;
+            if (x + w > ATLAS_W) { x = 0; y += shelfH; shelfH = 0; }
+            at[k] = {(float)(x + ATLAS_PAD), (float)(y + ATLAS_PAD)};
+            x += w;
+            shelfH = std::max(shelfH, h);
+        }
+        int height = 1;
+        while (height < y + shelfH) height *= 2;
+
+        Image sheet = GenImageColor(ATLAS_W, height, BLANK);
+        for (size_t k = 0; k < src.size(); ++k) {
+            if (src[k]->data == nullptr) continue;
+            blitPadded(sheet, *src[k], (int)at[k].x, (int)at[k].y);
+            dst[k]->src = {at[k].x, at[k].y, (float)src[k]->width, (float)src[k]->height};
+        }
+        atlas = LoadTextureFromImage(sheet);
+        UnloadImage(sheet);
+        for (Image* img : src) if (img->data) UnloadImage(*img);
+        // Solo el interior del bloque blanco: ni el filtrado toca el margen
+        white.src = {white.src.x + 1.f, white.src.y + 1.f, WHITE_BOX - 2.f, WHITE_BOX - 2.f};
+
+        if (atlas.id != 0) {
+            SetTextureFilter(atlas, TEXTURE_FILTER_POINT);
+            SetShapesTexture(atlas, white.src);
+        }
+        loaded = atlas.id != 0 && player.valid() && playerLife.valid() &&
+                 enemy1Anim[0].valid() && enemy2Anim[0].valid() && enemy3Anim[0].valid();
     }
 
     void unload() {
-        if (player.id != 0)           UnloadTexture(player);
-        if (playerLife.id != 0)       UnloadTexture(playerLife);
-        if (playerBody.id != 0)       UnloadTexture(playerBody);
-        if (playerThrusters.id != 0)  UnloadTexture(playerThrusters);
-        for (auto& t : enemy1Anim)    if (t.id != 0) UnloadTexture(t);
-        for (auto& t : enemy2Anim)    if (t.id != 0) UnloadTexture(t);
-        for (auto& t : enemy3Anim)    if (t.id != 0) UnloadTexture(t);
+        if (atlas.id != 0) {
+            SetShapesTexture({rlGetTextureIdDefault(), 1, 1, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8}, {0.f, 0.f, 1.f, 1.f});
+            UnloadTexture(atlas);
+        }
+        atlas = {};
+        forEach([](AtlasSprite& sp) { sp = {}; });
+        forEachBaked([](AtlasSprite& sp) { sp = {}; });
         loaded = false;
     }
 };
@@ -478,170 +1160,801 @@ struct SpriteAssets {
 static SpriteAssets gSprites;
 
 // Animación enemy1: 3 frames a ~7 fps
-static float gEnemyAnimTimer = 0.f;
-static int   gEnemyAnimFrame = 0;
 static constexpr float ENEMY_ANIM_INTERVAL = 1.f / 7.f;
 
 // Animación enemy2: ping-pong 6 frames, velocidad y fase distintas por enemigo
-static float gEnemy2Time = 0.f;
 // Secuencia ping-pong: 0-1-2-3-4-5-4-3-2-1 (10 pasos)
 static constexpr int ENEMY2_PINGPONG[10] = {0,1,2,3,4,5,4,3,2,1};
 // Velocidades base por "slot" (0-9): 3.0..5.5 fps, distribuidas de forma irregular
 static constexpr float ENEMY2_SPEEDS[10] = {4.0f,3.2f,5.0f,3.7f,4.8f,3.5f,5.3f,4.2f,3.0f,4.6f};
 
 // Animación enemy3: ping-pong 3 frames (0-1-2-1 = 4 pasos)
-static float gEnemy3Time = 0.f;
 static constexpr int   ENEMY3_PINGPONG[4]  = {0,1,2,1};
 static constexpr float ENEMY3_SPEEDS[10]   = {3.5f,4.2f,3.0f,4.8f,3.8f,5.0f,3.2f,4.5f,3.6f,4.1f};
 
-static void drawTextureCentered(const Texture2D& tex, float cx, float cy, float size, float rotationDeg = 0.f, bool pixelSnap = true) {
-    if (tex.id == 0) return;
-    Rectangle src = {0.f, 0.f, (float)tex.width, (float)tex.height};
-    float drawX = pixelSnap ? std::roundf(cx) : cx;
-    float drawY = pixelSnap ? std::roundf(cy) : cy;
-    Rectangle dst = {drawX, drawY, size, size};
-    Vector2 origin = {size * 0.5f, size * 0.5f};
-    DrawTexturePro(tex, src, dst, origin, rotationDeg, WHITE);
-}
+// Relojes de animación de enemigos (parte del estado de la partida)
+struct EnemyAnim {
+    float timer  = 0.f;   // enemy1
+    int   frame  = 0;
+    float time2  = 0.f;   // enemy2
+    float time3  = 0.f;   // enemy3
 
-void drawPlayerShip(float cx, float cy, float vx = 0.f, float thrusterTime = 0.f, float size = PLAYER_DRAW_SIZE) {
-    // ── Propulsores ──────────────────────────────────────────
-    if (gSprites.playerThrusters.id != 0) {
-        float pulse = (sinf(thrusterTime * 5.f) + 1.f) * 0.5f; // 0..1 a ~0.8Hz suave
-
-        float leftAlpha, rightAlpha;
-        const float threshold = 40.f;
-
-        if (vx < -threshold) {
-            // Movimiento izquierda → propulsor DERECHO activo
-            leftAlpha  = 0.22f + pulse * 0.16f;   // 0.22..0.38 visible pero apagado
-            rightAlpha = 0.75f + pulse * 0.20f;   // 0.75..0.95 potente
-        } else if (vx > threshold) {
-            // Movimiento derecha → propulsor IZQUIERDO activo
-            leftAlpha  = 0.75f + pulse * 0.20f;
-            rightAlpha = 0.22f + pulse * 0.16f;
-        } else {
-            // Reposo: ambos pulsan igual, rango estable
-            float a = 0.35f + pulse * 0.30f;       // 0.35..0.65
-            leftAlpha  = a;
-            rightAlpha = a;
+    void update(float dt) {
+        timer += dt;
+        if (timer >= ENEMY_ANIM_INTERVAL) {
+            timer -= ENEMY_ANIM_INTERVAL;
+            frame = (frame + 1) % 3;
         }
+        time2 += dt;
+        time3 += dt;
+    }
+};
 
-        int ix    = (int)roundf(cx);
-        int iy    = (int)roundf(cy);
-        int half  = (int)(size * 0.5f);
-        int isize = (int)size;
-
-        Rectangle src    = {0.f, 0.f, (float)gSprites.playerThrusters.width, (float)gSprites.playerThrusters.height};
-        Rectangle dst    = {cx, cy, size, size};
-        Vector2   origin = {size * 0.5f, size * 0.5f};
-
-        // Mitad izquierda
-        BeginScissorMode(ix - half, iy - half, half, isize);
-        DrawTexturePro(gSprites.playerThrusters, src, dst, origin, 0.f,
-            {255, 255, 255, (unsigned char)(leftAlpha * 255.f)});
-        EndScissorMode();
+// Coordenadas de textura normalizadas de un sprite del atlas
+struct AtlasUV {
+    float u0 = 0.f, v0 = 0.f, u1 = 0.f, v1 = 0.f;
 
-        // Mitad derecha
-        BeginScissorMode(ix, iy - half, half, isize);
-        DrawTexturePro(gSprites.playerThrusters, src, dst, origin, 0.f,
-            {255, 255, 255, (unsigned char)(rightAlpha * 255.f)});
-        EndScissorMode();
-
-        // Brillo aditivo en el propulsor activo al moverse
-        if (fabsf(vx) > threshold) {
-            BeginBlendMode(BLEND_ADDITIVE);
-            float glow = pulse * 0.35f;
-            Color gc = {255, 255, 255, (unsigned char)(glow * 255.f)};
-            if (vx > threshold) {
-                BeginScissorMode(ix - half, iy - half, half, isize);
-                DrawTexturePro(gSprites.playerThrusters, src, dst, origin, 0.f, gc);
-                EndScissorMode();
-            } else {
-                BeginScissorMode(ix, iy - half, half, isize);
-                DrawTexturePro(gSprites.playerThrusters, src, dst, origin, 0.f, gc);
-                EndScissorMode();
-            }
-            EndBlendMode();
-        }
+    AtlasUV() = default;
+    explicit AtlasUV(const AtlasSprite& sp) {
+        if (gSprites.atlas.width <= 0 || gSprites.atlas.height <= 0) return;
+        float iw = 1.f / gSprites.atlas.width, ih = 1.f / gSprites.atlas.height;
+        u0 = sp.src.x * iw; u1 = (sp.src.x + sp.src.width) * iw;
+        v0 = sp.src.y * ih; v1 = (sp.src.y + sp.src.height) * ih;
     }
+};
 
-    // ── Cuerpo de la nave ────────────────────────────────────
-    Texture2D& bodyTex = (gSprites.playerBody.id != 0) ? gSprites.playerBody : gSprites.player;
-    drawTextureCentered(bodyTex, cx, cy, size);
-}
+// Quads del atlas directos al lote de rlgl: 4 vértices cada uno y ninguna
+// llamada de dibujo propia; el lote se vacía solo al cambiar de modo de
+// mezcla o al llenarse. Se reabre cada CHUNK quads para comprobar el sitio
+// que queda en el búfer. finish() antes de cualquier otro Draw*.
+struct QuadStream {
+    static constexpr int CHUNK = 1024;
+    int  room = 0;
+    bool open = false;
+    unsigned int texture = 0;   // id GL; cambiarlo solo tras finish()
+
+    void reserve() {
+        if (room-- > 0) return;
+        if (open) rlEnd();
+        rlCheckRenderBatchLimit(4 * CHUNK);
+        rlSetTexture(texture);
+        rlBegin(RL_QUADS);
+        rlNormal3f(0.f, 0.f, 1.f);
+        room = CHUNK - 1;
+        open = true;
+    }
 
-static float enemyBaseRotation(EnemyType type) {
-    switch (type) {
-        case EnemyType::FLAGSHIP:
-        case EnemyType::ESCORT:
-            return 0.f;
-        case EnemyType::ZAKO_BLUE:
-        case EnemyType::ZAKO_BLUE2:
-            return 0.f;
-        case EnemyType::ZAKO_GREEN:
-            return 0.f;
+    // Esquinas en orden sup-izq, inf-izq, inf-der, sup-der (u0v0, u0v1, u1v1, u1v0)
+    void quad(const float x[4], const float y[4], const AtlasUV& uv, Color c) {
+        reserve();
+        rlColor4ub(c.r, c.g, c.b, c.a);
+        rlTexCoord2f(uv.u0, uv.v0); rlVertex2f(x[0], y[0]);
+        rlTexCoord2f(uv.u0, uv.v1); rlVertex2f(x[1], y[1]);
+        rlTexCoord2f(uv.u1, uv.v1); rlVertex2f(x[2], y[2]);
+        rlTexCoord2f(uv.u1, uv.v0); rlVertex2f(x[3], y[3]);
     }
-    return 0.f;
-}
 
-void drawEnemy(EnemyType type, float cx, float cy, float rotationDeg = 0.f, int animOffset = 0) {
-    switch (type) {
-        case EnemyType::FLAGSHIP:
-        case EnemyType::ESCORT:
-            drawTextureCentered(gSprites.enemy1Anim[(gEnemyAnimFrame + animOffset) % 3], cx, cy, ENEMY_DRAW_SIZE, rotationDeg, false);
-            break;
-        case EnemyType::ZAKO_BLUE:
-        case EnemyType::ZAKO_BLUE2: {
-            int slot  = animOffset % 10;
-            float spd = ENEMY2_SPEEDS[slot];
-            // Desfase de fase: cada slot empieza en un punto diferente del ciclo
-            float phase = slot * 1.3f;
-            int step  = (int)((gEnemy2Time * spd + phase)) % 10;
-            drawTextureCentered(gSprites.enemy2Anim[ENEMY2_PINGPONG[step]], cx, cy, ENEMY_DRAW_SIZE, rotationDeg, false);
-            break;
-        }
-        case EnemyType::ZAKO_GREEN: {
-            int slot  = animOffset % 10;
-            float spd = ENEMY3_SPEEDS[slot];
-            float phase = slot * 1.1f;
-            int step  = (int)(gEnemy3Time * spd + phase) % 4;
-            drawTextureCentered(gSprites.enemy3Anim[ENEMY3_PINGPONG[step]], cx, cy, ENEMY_DRAW_SIZE, rotationDeg, false);
-            break;
-        }
+    void finish() {
+        if (open) rlEnd();
+        open = false;
+        room = 0;
+        rlSetTexture(0);
     }
-}
+};
 
 // ─────────────────────────────────────────────────────────────
-//  ENEMY
+//  RENDER QUEUE
 // ─────────────────────────────────────────────────────────────
-struct Enemy {
-    EnemyType  type;
-    int        row, col;          // grid position
-    float      formX, formY;      // target formation position
-    float      x, y;              // current world position
-    EnemyState state = EnemyState::IN_FORMATION;
-    bool       alive = true;
+// El dibujo de la escena se graba como comandos en vez de ir directo a
+// raylib. submit() los ordena por (capa, secuencia, blend, textura, scissor)
+// y los envía por grupos: cada cambio de blend, textura o scissor vacía el
+// lote de raylib, así que agrupar deja un vaciado por grupo en vez de uno por
+// cada vez que el código alternaba. Las capas fijan el orden de pintado
+// donde hay solape; dentro de una capa la secuencia (nextSeq) separa piezas
+// que se solapan entre sí y tienen que salir enteras una tras otra, como el
+// círculo y la letra de cada power-up. Con la misma capa y secuencia el
+// orden entre blends o texturas distintos no está garantizado (solo se usa
+// con dibujos que no se tapan: textos y barras del HUD, el brillo aditivo
+// de los propulsores); dentro de un grupo se respeta el de grabación.
+enum DrawLayer : uint8_t {
+    LAYER_STARS,
+    LAYER_ENEMIES,
+    LAYER_BULLETS,
+    LAYER_PICKUPS,
+    LAYER_SHIP_BACK,   // propulsores, bajo el casco
+    LAYER_SHIP,
+    LAYER_HUD,
+    LAYER_FX,          // explosiones aditivas
+    LAYER_FX_DEBRIS,
+};
 
-    // Dive path (Bezier control points)
-    float      t   = 0.f;         // path parameter 0..1
-    float      diveSpeed = 200.f;
-    Vector2    p0, p1, p2, p3;    // cubic Bezier
-    float      diveTargetX = SW * 0.5f;
+// Las formas también salen del atlas (SetShapesTexture); el texto usa la
+// fuente y TEX_HUD es la textura de HudLayer
+enum DrawTexture : uint8_t { TEX_ATLAS, TEX_FONT, TEX_HUD };
+
+struct DrawCmd {
+    enum Kind : uint8_t { QUAD, CIRCLE, TEXT };
+    uint64_t key;          // capa<<40 | secuencia<<24 | blend<<16 | textura<<8 | scissor
+    Kind     kind;
+    Color    color;
+    // QUAD: esquinas como QuadStream::quad. CIRCLE: centro en [0], radio en
+    // x[1]. TEXT: origen en [0], tamaño en x[1]
+    float    x[4], y[4];
+    AtlasUV  uv;
+    uint32_t text = 0;     // TEXT: inicio en RenderQueue::chars
+};
 
-    // Shooting timer
-    float      shootTimer  = 0.f;
-    float      shootInterval = 0.f;
-    int        bulletsLeft  = 0;
+struct RenderQueue {
+    struct Stats {
+        int commands = 0;
+        int groups   = 0;
+        int flushes  = 0;   // cambios de estado tal como se envió
+        int unsorted = 0;   // los que habría en orden de grabación
+        int saved() const { return unsorted - flushes; }
+    };
 
-    // Return-to-formation arc
-    float      retT  = 0.f;
+    std::vector<DrawCmd>   cmds;
+    std::vector<Rectangle> scissors;   // id de scissor - 1
+    std::vector<char>      chars;      // texto del frame (TextFormat reutiliza su búfer)
+    std::vector<uint64_t>  keys;                  // para submit()
+    std::vector<uint32_t>  bucket, start, order;
+    Stats last;
+    unsigned int hudTexture = 0;
+
+    // Estado de grabación, como los pares Begin*/End* de raylib
+    uint8_t  layer = 0, blend = BLEND_ALPHA, scissor = 0;
+    uint16_t seq   = 0;
+
+    void begin(DrawLayer l) { layer = l; seq = 0; blend = BLEND_ALPHA; scissor = 0; }
+    // Lo grabado desde aquí se pinta encima de lo anterior de la capa, sea
+    // cual sea su estado. Pasados 65535 pasos se comparte el último
+    void nextSeq() { if (seq < 0xFFFF) ++seq; }
+    void setBlend(int mode) { blend = (uint8_t)mode; }
+    // Un frame usa unos pocos; agotados los 255 ids se repite el último
+    void setScissor(int x, int y, int w, int h) {
+        if (scissors.size() < 255) scissors.push_back({(float)x, (float)y, (float)w, (float)h});
+        scissor = (uint8_t)scissors.size();
+    }
+    void clearScissor() { scissor = 0; }
+
+    DrawCmd& push(DrawCmd::Kind kind, DrawTexture tex, Color c) {
+        cmds.emplace_back();
+        DrawCmd& d = cmds.back();
+        d.key   = (uint64_t)layer << 40 | (uint64_t)seq << 24 | (uint64_t)blend << 16 | (uint64_t)tex << 8 | scissor;
+        d.kind  = kind;
+        d.color = c;
+        return d;
+    }
+
+    void rect(float x0, float y0, float x1, float y1, const AtlasUV& uv, Color c, DrawTexture tex = TEX_ATLAS) {
+        DrawCmd& d = push(DrawCmd::QUAD, tex, c);
+        d.x[0] = x0; d.y[0] = y0;
+        d.x[1] = x0; d.y[1] = y1;
+        d.x[2] = x1; d.y[2] = y1;
+        d.x[3] = x1; d.y[3] = y0;
+        d.uv = uv;
+    }
+
+    // Centro c; a es el semieje a lo largo de u y b a lo largo de v (ya rotados)
+    void oriented(Vector2 c, Vector2 a, Vector2 b, const AtlasUV& uv, Color col) {
+        DrawCmd& d = push(DrawCmd::QUAD, TEX_ATLAS, col);
+        d.x[0] = c.x - a.x - b.x; d.y[0] = c.y - a.y - b.y;
+        d.x[1] = c.x - a.x + b.x; d.y[1] = c.y - a.y + b.y;
+        d.x[2] = c.x + a.x + b.x; d.y[2] = c.y + a.y + b.y;
+        d.x[3] = c.x + a.x - b.x; d.y[3] = c.y + a.y - b.y;
+        d.uv = uv;
+    }
+
+    // Como DrawRectangle: el texel blanco del atlas
+    void fillRect(int x, int y, int w, int h, Color c) {
+        rect((float)x, (float)y, (float)(x + w), (float)(y + h), AtlasUV(gSprites.white), c);
+    }
+
+    void circle(int cx, int cy, float r, Color c) {
+        DrawCmd& d = push(DrawCmd::CIRCLE, TEX_ATLAS, c);
+        d.x[0] = (float)cx; d.y[0] = (float)cy; d.x[1] = r;
+    }
+
+    void text(const char* s, int x, int y, int size, Color c) {
+        DrawCmd& d = push(DrawCmd::TEXT, TEX_FONT, c);
+        d.x[0] = (float)x; d.y[0] = (float)y; d.x[1] = (float)size;
+        d.text = (uint32_t)chars.size();
+        chars.insert(chars.end(), s, s + strlen(s) + 1);
+    }
+
+    void submit() {
+        const int n = (int)cmds.size();
+        // Claves distintas en orden y reparto por cuentas: estable dentro de
+        // cada clave sin comparar comando a comando
+        keys.clear();
+        for (const DrawCmd& c : cmds)
+            if (keys.empty() || keys.back() != c.key) keys.push_back(c.key);
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        start.assign(keys.size() + 1, 0);
+        bucket.resize(n);
+        for (int i = 0; i < n; ++i) {
+            bucket[i] = (uint32_t)(std::lower_bound(keys.begin(), keys.end(), cmds[i].key) - keys.begin());
+            ++start[bucket[i] + 1];
+        }
+        for (size_t k = 1; k < start.size(); ++k) start[k] += start[k - 1];
+        order.resize(n);
+        for (int i = 0; i < n; ++i) order[start[bucket[i]]++] = (uint32_t)i;
+
+        // Blend, textura y scissor; capa y secuencia solas no obligan a vaciar
+        auto state = [](uint64_t key) { return (uint32_t)(key & 0xFFFFFFu); };
+        last = {};
+        last.commands = n;
+        last.groups   = (int)keys.size();
+        for (int i = 1; i < n; ++i)
+            last.unsorted += state(cmds[i].key) != state(cmds[i - 1].key);
+
+        QuadStream qs;
+        int curBlend = -1, curTex = -1, curScissor = 0;
+        for (int k = 0; k < n; ++k) {
+            const DrawCmd& c = cmds[order[k]];
+            if (k > 0 && state(c.key) != state(cmds[order[k - 1]].key)) ++last.flushes;
+            int b = (int)(c.key >> 16 & 0xFF), t = (int)(c.key >> 8 & 0xFF), s = (int)(c.key & 0xFF);
+            if (b != curBlend || t != curTex || s != curScissor) {
+                qs.finish();
+                qs.texture = t == TEX_HUD ? hudTexture : gSprites.atlas.id;
+                curTex = t;
+                if (s != curScissor) {
+                    if (curScissor) EndScissorMode();
+                    if (s) {
+                        const Rectangle& r = scissors[s - 1];
+                        BeginScissorMode((int)r.x, (int)r.y, (int)r.width, (int)r.height);
+                    }
+                    curScissor = s;
+                }
+                if (b != curBlend) { BeginBlendMode(b); curBlend = b; }
+            }
+            switch (c.kind) {
+                case DrawCmd::QUAD:
+                    qs.quad(c.x, c.y, c.uv, c.color);
+                    break;
+                case DrawCmd::CIRCLE:
+                    qs.finish();
+                    DrawCircle((int)c.x[0], (int)c.y[0], c.x[1], c.color);
+                    break;
+                case DrawCmd::TEXT:
+                    qs.finish();
+                    DrawText(&chars[c.text], (int)c.x[0], (int)c.y[0], (int)c.x[1], c.color);
+                    break;
+            }
+        }
+        qs.finish();
+        if (curScissor) EndScissorMode();
+        if (curBlend >= 0) EndBlendMode();
+
+        cmds.clear();
+        scissors.clear();
+        chars.clear();
+        begin(LAYER_STARS);
+    }
+};
+
+static RenderQueue gDraw;
+
+// Todas las estrellas en un grupo: quads del texel blanco del atlas
+void StarField::draw() const {
+    const AtlasUV white(gSprites.white);
+    gDraw.begin(LAYER_STARS);
+    forEach([&](float x, float y, const StarLayer& l) {
+        float x0 = (float)(int)x, y0 = (float)(int)y;
+        unsigned char b = l.brightness;
+        gDraw.rect(x0, y0, x0 + l.size, y0 + l.size, white, {b, b, b, 255});
+    });
+}
+
+static void drawSprite(const AtlasSprite& sp, float cx, float cy, float size, float rotationDeg = 0.f,
+                       bool pixelSnap = true, Color tint = WHITE) {
+    if (!sp.valid()) return;
+    float drawX = pixelSnap ? std::roundf(cx) : cx;
+    float drawY = pixelSnap ? std::roundf(cy) : cy;
+    float h = size * 0.5f;
+    if (rotationDeg == 0.f) {
+        gDraw.rect(drawX - h, drawY - h, drawX + h, drawY + h, AtlasUV(sp), tint);
+    } else {
+        float cs = cosf(rotationDeg * DEG2RAD) * h, sn = sinf(rotationDeg * DEG2RAD) * h;
+        gDraw.oriented({drawX, drawY}, {cs, sn}, {-sn, cs}, AtlasUV(sp), tint);
+    }
+}
+
+// value con ceros a la izquierda hasta width cifras, como "%0*d", desde las
+// cifras horneadas. size es uno de HUD_DIGIT_SIZES
+static void drawDigits(int value, int width, int x, int y, int size, Color c) {
+    const int k = size == HUD_DIGIT_SIZES[0] ? 0 : 1;
+    int digits[12], n = 0;
+    unsigned v = (unsigned)std::max(value, 0);
+    do { digits[n++] = (int)(v % 10); v /= 10; } while (v != 0);
+    while (n < width && n < 12) digits[n++] = 0;
+    float px = (float)x;
+    while (n-- > 0) {
+        const AtlasSprite& g = gSprites.digit[k][digits[n]];
+        if (g.valid()) gDraw.rect(px, (float)y, px + g.src.width, (float)y + g.src.height, AtlasUV(g), c);
+        px += gSprites.digitAdvance[k][digits[n]];
+    }
+}
+
+// ─────────────────────────────────────────────────────────────
+//  HUD LAYER
+// ─────────────────────────────────────────────────────────────
+// El HUD cambia unas pocas veces por segundo y se compone en cada frame: se
+// pinta en su propia textura solo cuando cambia su clave (puntos, vidas,
+// ronda, power-up), y el resto de frames es un único quad. Lo que cambia
+// cada frame (barra del power-up, vida del jefe) se dibuja encima aparte.
+struct HudLayer {
+    using Key = std::array<int, 6>;
+
+    RenderTexture2D rt = {};
+    Key  key     = {};
+    bool current = false;   // rt tiene el HUD de key
+    int  renders = 0;
+
+    void load() {
+        rt = LoadRenderTexture(SW, SH);
+        current = false;
+        gDraw.hudTexture = rt.texture.id;
+    }
+
+    void unload() {
+        if (rt.id != 0) UnloadRenderTexture(rt);
+        rt = {};
+        current = false;
+        gDraw.hudTexture = 0;
+    }
+
+    // Repinta si k ha cambiado; paint() graba el HUD en gDraw. Llamar fuera
+    // de BeginTextureMode: raylib no anida destinos.
+    template <class Fn> void refresh(const Key& k, Fn&& paint) {
+        if (rt.id == 0 || (current && k == key)) return;
+        BeginTextureMode(rt);
+        ClearBackground(BLANK);
+        // Sin mezcla: la textura guarda color y alpha tal cual y se mezclan
+        // una sola vez al componer, como si se dibujara directo en la escena
+        rlDrawRenderBatchActive();
+        rlDisableColorBlend();
+        paint();
+        gDraw.submit();
+        rlDrawRenderBatchActive();
+        rlEnableColorBlend();
+        EndTextureMode();
+        key = k;
+        current = true;
+        ++renders;
+    }
+
+    // La textura en un quad (las de destino están invertidas en v); false si
+    // no tiene el HUD de k
+    bool draw(const Key& k) const {
+        if (!current || k != key) return false;
+        AtlasUV uv;
+        uv.u0 = 0.f; uv.v0 = 1.f; uv.u1 = 1.f; uv.v1 = 0.f;
+        gDraw.begin(LAYER_HUD);
+        gDraw.rect(0.f, 0.f, (float)SW, (float)SH, uv, WHITE, TEX_HUD);
+        return true;
+    }
+};
+
+static HudLayer gHud;
+
+// Un quad por elemento con el mismo sprite. Posición entera como los Draw*
+// de antes; pos(item) da el centro y anchor es el centro dentro del sprite.
+template<class Items, class PosFn>
+static void drawAtlasQuads(const Items& items, const AtlasSprite& sp, Vector2 anchor, PosFn pos) {
+    if (!sp.valid() || items.empty()) return;
+    const AtlasUV uv(sp);
+    for (const auto& item : items) {
+        Vector2 p = pos(item);
+        float x0 = (float)(int)p.x - anchor.x, y0 = (float)(int)p.y - anchor.y;
+        gDraw.rect(x0, y0, x0 + sp.src.width, y0 + sp.src.height, uv, WHITE);
+    }
+}
+
+// Explosiones con las texturas horneadas: flashes, anillos y partículas en la
+// capa aditiva, restos en la alpha. El número de llamadas de dibujo no
+// depende de cuántas haya.
+void Effects::draw() const {
+    if (gSprites.atlas.id == 0) return;
+    const AtlasUV dotUV(gSprites.fxDot), flashUV(gSprites.fxFlash), sparkUV(gSprites.fxSpark);
+    const AtlasUV whiteUV(gSprites.white);
+    gDraw.begin(LAYER_FX);
+    gDraw.setBlend(BLEND_ADDITIVE);
+
+    // Flash + shockwave ring
+    const FlashPool& fl = flashes;
+    for (int i = 0; i < fl.count; ++i) {
+        float t = fl.life[i] / fl.maxLife[i];
+        float cx = (float)(int)fl.x[i], cy = (float)(int)fl.y[i];
+        // Core flash (shrinks slightly)
+        float r = fl.radius[i] * (0.9f + t * 0.4f);
+        gDraw.rect(cx - r, cy - r, cx + r, cy + r, flashUV, {255, 255, 255, (unsigned char)(t * 230)});
+        // Expanding ring (grows outward as flash fades): the baked ring with
+        // the nearest radius, scaled
+        float ringR = fl.radius[i] * (1.0f + (1.0f - t) * 2.2f);
+        int k = 0;
+        while (k < 4 && ringR * ringR > FX_RING_RADII[k] * FX_RING_RADII[k + 1]) ++k;
+        const AtlasSprite& ring = gSprites.fxRing[k];
+        float half = ring.src.width * 0.5f * ringR / FX_RING_RADII[k];
+        gDraw.rect(fl.x[i] - half, fl.y[i] - half, fl.x[i] + half, fl.y[i] + half, AtlasUV(ring),
+            {255, 200, 60, (unsigned char)(t * 160)});
+    }
+
+    // Particles
+    const ParticlePool& p = particles;
+    for (int i = 0; i < p.count; ++i) {
+        float t = p.life[i] / p.maxLife[i];
+        Color pc = p.color[i];
+        Color c = {pc.r, pc.g, pc.b, (unsigned char)(t * 255)};
+
+        if (p.type[i] == ParticleType::SPARK) {
+            float len = p.size[i] * 5.f * t;
+            float mag2 = p.vx[i] * p.vx[i] + p.vy[i] * p.vy[i];
+            if (mag2 > 0.f) {
+                // Half-axes: along the velocity (len / 2) and across it (0.75)
+                float k = 1.f / sqrtf(mag2);
+                float nx = p.vx[i] * k, ny = p.vy[i] * k;
+                Vector2 mid = {p.x[i] - nx * len * 0.5f, p.y[i] - ny * len * 0.5f};
+                gDraw.oriented(mid, {nx * len * 0.5f, ny * len * 0.5f}, {-ny * 0.75f, nx * 0.75f}, sparkUV, c);
+            }
+        } else {
+            float sz = p.size[i] * (0.4f + 0.6f * t);
+            float cx = (float)(int)p.x[i], cy = (float)(int)p.y[i];
+            gDraw.rect(cx - sz, cy - sz, cx + sz, cy + sz, dotUV, c);
+        }
+    }
+
+    gDraw.begin(LAYER_FX_DEBRIS);
+
+    // Debris fragments – blend normal, sólidos
+    const DebrisPool& d = debris;
+    for (int i = 0; i < d.count; ++i) {
+        float t = d.life[i] / d.maxLife[i];
+        Color c = {d.color[i].r, d.color[i].g, d.color[i].b, (unsigned char)(t * 230)};
+        float cs = cosf(d.rot[i] * DEG2RAD), sn = sinf(d.rot[i] * DEG2RAD);
+        float hw = d.w[i] * 0.5f, hh = d.h[i] * 0.5f;
+        gDraw.oriented({d.x[i], d.y[i]}, {cs * hw, sn * hw}, {-sn * hh, cs * hh}, whiteUV, c);
+    }
+}
+
+// Alpha de cada mitad del propulsor y brillo aditivo del lado activo
+// (glowSide: -1 mitad izquierda, +1 mitad derecha, 0 sin brillo).
+struct ThrusterLevels {
+    float left, right, glow;
+    int   glowSide;
+};
+
+static ThrusterLevels thrusterLevels(float vx, float thrusterTime) {
+    float pulse = (sinf(thrusterTime * 5.f) + 1.f) * 0.5f; // 0..1 a ~0.8Hz suave
+    const float threshold = 40.f;
+    ThrusterLevels t;
+    if (vx < -threshold) {
+        // Movimiento izquierda → propulsor DERECHO activo
+        t.left  = 0.22f + pulse * 0.16f;   // 0.22..0.38 visible pero apagado
+        t.right = 0.75f + pulse * 0.20f;   // 0.75..0.95 potente
+    } else if (vx > threshold) {
+        // Movimiento derecha → propulsor IZQUIERDO activo
+        t.left  = 0.75f + pulse * 0.20f;
+        t.right = 0.22f + pulse * 0.16f;
+    } else {
+        // Reposo: ambos pulsan igual, rango estable
+        float a = 0.35f + pulse * 0.30f;       // 0.35..0.65
+        t.left  = a;
+        t.right = a;
+    }
+    // Brillo aditivo en el propulsor activo al moverse
+    t.glow     = pulse * 0.35f;
+    t.glowSide = vx > threshold ? -1 : (vx < -threshold ? 1 : 0);
+    return t;
+}
+
+void drawPlayerShip(float cx, float cy, float vx = 0.f, float thrusterTime = 0.f, float size = PLAYER_DRAW_SIZE) {
+    // ── Propulsores ──────────────────────────────────────────
+    if (gSprites.playerThrusters.valid()) {
+        ThrusterLevels lv = thrusterLevels(vx, thrusterTime);
+
+        int ix    = (int)roundf(cx);
+        int iy    = (int)roundf(cy);
+        int half  = (int)(size * 0.5f);
+        int isize = (int)size;
+
+        const AtlasSprite& tr = gSprites.playerThrusters;
+        gDraw.begin(LAYER_SHIP_BACK);
+
+        // Mitad izquierda
+        gDraw.setScissor(ix - half, iy - half, half, isize);
+        drawSprite(tr, cx, cy, size, 0.f, false, {255, 255, 255, (unsigned char)(lv.left * 255.f)});
+
+        // Mitad derecha
+        gDraw.setScissor(ix, iy - half, half, isize);
+        drawSprite(tr, cx, cy, size, 0.f, false, {255, 255, 255, (unsigned char)(lv.right * 255.f)});
+
+        if (lv.glowSide != 0) {
+            gDraw.setBlend(BLEND_ADDITIVE);
+            Color gc = {255, 255, 255, (unsigned char)(lv.glow * 255.f)};
+            gDraw.setScissor(lv.glowSide < 0 ? ix - half : ix, iy - half, half, isize);
+            drawSprite(tr, cx, cy, size, 0.f, false, gc);
+        }
+    }
+
+    // ── Cuerpo de la nave ────────────────────────────────────
+    const AtlasSprite& body = gSprites.playerBody.valid() ? gSprites.playerBody : gSprites.player;
+    gDraw.begin(LAYER_SHIP);
+    drawSprite(body, cx, cy, size);
+}
+
+static float enemyBaseRotation(EnemyType type) {
+    switch (type) {
+        case EnemyType::FLAGSHIP:
+        case EnemyType::ESCORT:
+            return 0.f;
+        case EnemyType::ZAKO_BLUE:
+        case EnemyType::ZAKO_BLUE2:
+            return 0.f;
+        case EnemyType::ZAKO_GREEN:
+            return 0.f;
+    }
+    return 0.f;
+}
+
+// Frame de animación de un enemigo de la formación (set 1..3, índice en el set)
+struct AnimFrame { int set, index; };
+
+static AnimFrame enemyAnimFrame(const EnemyAnim& anim, EnemyType type, int animOffset) {
+    switch (type) {
+        case EnemyType::FLAGSHIP:
+        case EnemyType::ESCORT:
+            return {1, (anim.frame + animOffset) % 3};
+        case EnemyType::ZAKO_BLUE:
+        case EnemyType::ZAKO_BLUE2: {
+            int slot  = animOffset % 10;
+            float spd = ENEMY2_SPEEDS[slot];
+            // Desfase de fase: cada slot empieza en un punto diferente del ciclo
+            float phase = slot * 1.3f;
+            int step  = (int)((anim.time2 * spd + phase)) % 10;
+            return {2, ENEMY2_PINGPONG[step]};
+        }
+        case EnemyType::ZAKO_GREEN: {
+            int slot  = animOffset % 10;
+            float spd = ENEMY3_SPEEDS[slot];
+            float phase = slot * 1.1f;
+            int step  = (int)(anim.time3 * spd + phase) % 4;
+            return {3, ENEMY3_PINGPONG[step]};
+        }
+    }
+    return {1, 0};
+}
+
+// El jefe usa el sprite de su tipo a velocidad fija, sin desfase
+static AnimFrame bossAnimFrame(const EnemyAnim& anim, EnemyType type) {
+    if (type == EnemyType::FLAGSHIP)  return {1, anim.frame % 3};
+    if (type == EnemyType::ZAKO_BLUE) return {2, ENEMY2_PINGPONG[(int)(anim.time2 * 4.0f) % 10]};
+    return {3, ENEMY3_PINGPONG[(int)(anim.time3 * 4.0f) % 4]};
+}
+
+void drawEnemy(const EnemyAnim& anim, EnemyType type, float cx, float cy, float rotationDeg = 0.f, int animOffset = 0) {
+    AnimFrame f = enemyAnimFrame(anim, type, animOffset);
+    drawSprite(gSprites.enemyFrame(f.set, f.index), cx, cy, ENEMY_DRAW_SIZE, rotationDeg, false);
+}
+
+// ─────────────────────────────────────────────────────────────
+//  PATHS
+// ─────────────────────────────────────────────────────────────
+// Cubic Bezier evaluation
+static Vector2 bezier(Vector2 p0, Vector2 p1, Vector2 p2, Vector2 p3, float t) {
+    float u = 1.f - t;
+    return {
+        u*u*u*p0.x + 3*u*u*t*p1.x + 3*u*t*t*p2.x + t*t*t*p3.x,
+        u*u*u*p0.y + 3*u*u*t*p1.y + 3*u*t*t*p2.y + t*t*t*p3.y
+    };
+}
+
+// d/dt of bezier(): direction of travel, not normalised
+static Vector2 bezierTangent(Vector2 p0, Vector2 p1, Vector2 p2, Vector2 p3, float t) {
+    float u = 1.f - t;
+    float a = 3*u*u, b = 6*u*t, c = 3*t*t;
+    return {
+        a*(p1.x - p0.x) + b*(p2.x - p1.x) + c*(p3.x - p2.x),
+        a*(p1.y - p0.y) + b*(p2.y - p1.y) + c*(p3.y - p2.y)
+    };
+}
+
+// Arc length of a curve at PATH_LUT_SEGS uniform steps of t, built once per
+// launch. param() maps distance travelled back to t (binary search, then a
+// linear blend inside the segment), so paths are walked at true speed.
+static constexpr int PATH_LUT_SEGS = 32;
+
+struct PathLut {
+    float len[PATH_LUT_SEGS + 1] = {};   // len[k]: length up to t = k / SEGS
+
+    void build(Vector2 p0, Vector2 p1, Vector2 p2, Vector2 p3) {
+        Vector2 prev = p0;
+        len[0] = 0.f;
+        for (int k = 1; k <= PATH_LUT_SEGS; ++k) {
+            Vector2 q = bezier(p0, p1, p2, p3, (float)k / PATH_LUT_SEGS);
+            len[k] = len[k - 1] + std::hypot(q.x - prev.x, q.y - prev.y);
+            prev = q;
+        }
+    }
+
+    float total() const { return len[PATH_LUT_SEGS]; }
+
+    float param(float dist) const {
+        if (dist >= total()) return 1.f;
+        int lo = 0, hi = PATH_LUT_SEGS;   // len[lo] <= dist < len[hi]
+        while (hi - lo > 1) {
+            int mid = (lo + hi) / 2;
+            if (len[mid] <= dist) lo = mid; else hi = mid;
+        }
+        float seg = len[hi] - len[lo];
+        float f   = seg > 0.f ? (dist - len[lo]) / seg : 0.f;
+        return ((float)lo + f) / PATH_LUT_SEGS;
+    }
+};
+
+// ─────────────────────────────────────────────────────────────
+//  ENEMY
+// ─────────────────────────────────────────────────────────────
+static constexpr int ENEMY_CAPACITY = FORM_MAX_ROWS * FORM_MAX_COLS;
+
+// Dive and return-to-formation paths. Only divers and returners read
+// these, so they live apart from the hot per-frame columns.
+struct EnemyPath {
+    // Distance along the active curve (dive, then return) and its table
+    float      dist = 0.f;
+    PathLut    lut;
+
+    // Dive path (Bezier control points)
+    float      diveSpeed = 200.f;   // px/s along the curve
+    Vector2    p0, p1, p2, p3;    // cubic Bezier
+    float      diveTargetX = SW * 0.5f;
+
+    // Shooting timer
+    float      shootTimer  = 0.f;
+    float      shootInterval = 0.f;
+    int        bulletsLeft  = 0;
+
+    // Return-to-formation arc; retP3 is the slot as of the launch, the
+    // curve is shifted to the live slot when evaluated
     Vector2    retP0, retP1, retP2, retP3;
+};
+
+// All enemies of the round in one structure-of-arrays, partitioned by state:
+//   [0, formEnd) in formation, [formEnd, diveEnd) diving,
+//   [diveEnd, alive) returning, [alive, count) dead.
+// Each update phase walks only its own range, and aliveCount() is the
+// partition boundary. Moving an enemy between states swaps it across the
+// boundaries (at most three swaps); id stays fixed and pos[id] finds it.
+struct EnemyStore {
+    // Hot columns, indexed by partition position
+    std::vector<float>     x, y;             // current world position
+    std::vector<float>     prevX, prevY;     // position at previous tick
+    std::vector<float>     heading;          // sprite rotation along the path (deg)
+    std::vector<EnemyType> type;
+    std::vector<uint8_t>   row, col;         // grid position
+    std::vector<uint16_t>  id;               // spawn order, stable
+    std::vector<uint32_t>  dives;            // picadas lanzadas (clave del stream por entidad)
+
+    // Cold, indexed by id
+    std::vector<EnemyPath> path;
+    std::vector<uint16_t>  pos;              // id -> partition position
+
+    int count   = 0;   // spawned this round (alive or dead)
+    int formEnd = 0;
+    int diveEnd = 0;
+    int alive   = 0;
+
+    int capacity() const { return (int)x.size(); }
+
+    // Sizes the store for a formation; allocates only when capacity changes
+    void reset(int cap) {
+        clear();
+        if (cap == capacity()) return;
+        columns(*this, [cap](auto& col) { col.resize(cap); });
+        path.resize(cap);
+        pos.resize(cap);
+    }
+
+    template <class S, class Fn>
+    static void columns(S& s, Fn fn) {
+        fn(s.x); fn(s.y); fn(s.prevX); fn(s.prevY); fn(s.heading);
+        fn(s.type); fn(s.row); fn(s.col); fn(s.id); fn(s.dives);
+    }
+
+    void clear() { count = formEnd = diveEnd = alive = 0; }
+
+    // New enemy parked in formation (only while building a round: the
+    // partition is all formation then)
+    void add(EnemyType t, int r, int c, float px, float py) {
+        int i = count++;
+        x[i] = prevX[i] = px;
+        y[i] = prevY[i] = py;
+        heading[i] = 0.f;
+        type[i] = t;
+        row[i]  = (uint8_t)r;
+        col[i]  = (uint8_t)c;
+        id[i]   = (uint16_t)i;
+        dives[i] = 0;
+        path[i] = {};
+        pos[i]  = (uint16_t)i;
+        formEnd = diveEnd = alive = count;
+    }
+
+    int  aliveCount() const { return alive; }
+    int  formationCount() const { return formEnd; }
+    bool isAlive(int i) const { return i < alive; }
+    EnemyState state(int i) const {
+        return i < formEnd ? EnemyState::IN_FORMATION
+             : i < diveEnd ? EnemyState::DIVING : EnemyState::RETURNING;
+    }
+
+    EnemyPath&       pathAt(int i)       { return path[id[i]]; }
+    const EnemyPath& pathAt(int i) const { return path[id[i]]; }
 
     // Hitbox (~80% del tamaño visual)
-    Rectangle hitbox() const {
+    Rectangle hitbox(int i) const { return hitboxAt(x[i], y[i]); }
+    static Rectangle hitboxAt(float px, float py) {
         float hw = 14.f, hh = 12.f;
-        return { x - hw, y - hh, hw*2, hh*2 };
+        return { px - hw, py - hh, hw*2, hh*2 };
+    }
+
+    void swapEntries(int i, int j) {
+        if (i == j) return;
+        columns(*this, [i, j](auto& col) { std::swap(col[i], col[j]); });
+        pos[id[i]] = (uint16_t)i;
+        pos[id[j]] = (uint16_t)j;
+    }
+
+    // Moves entry i to state s (or to the dead range when dead is set) and
+    // returns its new position. Entries of the ranges it crosses are
+    // reordered, so a loop over a range must re-read the entry at i.
+    int moveTo(int i, EnemyState s, bool dead = false) {
+        int* ends[3] = {&formEnd, &diveEnd, &alive};
+        int from = isAlive(i) ? (int)state(i) : 3;
+        int to   = dead ? 3 : (int)s;
+        for (int k = from; k < to; ++k) {        // rightwards: last of range k
+            int last = --*ends[k];
+            swapEntries(i, last);
+            i = last;
+        }
+        for (int k = from - 1; k >= to; --k) {   // leftwards: first of range k+1
+            int first = (*ends[k])++;
+            swapEntries(i, first);
+            i = first;
+        }
+        return i;
+    }
+    int kill(int i) { return moveTo(i, EnemyState::IN_FORMATION, true); }
+
+    // Sends every diver and returner back to formation (positions untouched:
+    // the caller parks them on their slots)
+    void recallAll() { formEnd = diveEnd = alive; }
+
+    template <class S, class Ar>
+    static void serialize(S& s, Ar& ar) {
+        int cap = s.capacity();
+        ar.pod(cap);
+        ar.pod(s.count);
+        ar.pod(s.formEnd);
+        ar.pod(s.diveEnd);
+        ar.pod(s.alive);
+        bool valid = cap >= 0 && cap <= ENEMY_CAPACITY && s.count >= 0 && s.count <= cap && 0 <= s.formEnd &&
+                     s.formEnd <= s.diveEnd && s.diveEnd <= s.alive && s.alive <= s.count;
+        if (!ar.check(valid)) {
+            if constexpr (!std::is_const_v<S>) s.clear();
+            return;
+        }
+        if constexpr (!std::is_const_v<S>) {
+            if (cap != s.capacity()) {
+                int count = s.count, formEnd = s.formEnd, diveEnd = s.diveEnd, alive = s.alive;
+                s.reset(cap);
+                s.count = count; s.formEnd = formEnd; s.diveEnd = diveEnd; s.alive = alive;
+            }
+        }
+        columns(s, [&](auto& col) { ar.raw(col.data(), s.count * sizeof(col[0])); });
+        ar.raw(s.path.data(), s.count * sizeof(EnemyPath));
+        ar.raw(s.pos.data(), s.count * sizeof(uint16_t));
     }
 };
 
@@ -650,6 +1963,7 @@ struct Boss {
     EnemyType type = EnemyType::FLAGSHIP;
     float     x = SW * 0.5f;
     float     y = 130.f;
+    float     prevX = SW * 0.5f;
     float     vx = 120.f;
     float     size = 88.f;
     int       hp = 0;
@@ -657,28 +1971,21 @@ struct Boss {
     float     shotTimer = 0.f;
     float     shotInterval = 1.2f;
 
-    Rectangle hitbox() const {
+    Rectangle hitbox() const { return hitboxAt(x); }
+    Rectangle hitboxAt(float px) const {
         float hw = size * 0.36f;
         float hh = size * 0.32f;
-        return { x - hw, y - hh, hw * 2.f, hh * 2.f };
+        return { px - hw, y - hh, hw * 2.f, hh * 2.f };
     }
 };
 
-// Cubic Bezier evaluation
-static Vector2 bezier(Vector2 p0, Vector2 p1, Vector2 p2, Vector2 p3, float t) {
-    float u = 1.f - t;
-    return {
-        u*u*u*p0.x + 3*u*u*t*p1.x + 3*u*t*t*p2.x + t*t*t*p3.x,
-        u*u*u*p0.y + 3*u*u*t*p1.y + 3*u*t*t*p2.y + t*t*t*p3.y
-    };
-}
-
 // ─────────────────────────────────────────────────────────────
 //  PLAYER
 // ─────────────────────────────────────────────────────────────
 struct Player {
     float  x = SW / 2.f;
     float  y = PLAYER_Y;
+    float  prevX = SW / 2.f;
     float  vx = 0.f;
     float  thrusterTime = 0.f;
     int    lives = 3;
@@ -706,6 +2013,225 @@ struct Player {
     Rectangle hitbox() const { return { x-9, y-18, 18, 26 }; }  // cuerpo (colisión simple)
 };
 
+// ─────────────────────────────────────────────────────────────
+//  COLLISION GRID
+// ─────────────────────────────────────────────────────────────
+// Narrowphase: one rectangle against up to AABB_BATCH boxes stored as
+// min/max arrays. Bit i of the result is set when r overlaps box i, with
+// the same strict comparisons as raylib's CheckCollisionRecs (touching
+// edges do not collide; max = x + width is precomputed in float exactly as
+// it computes it).
+static constexpr int AABB_BATCH = 32;
+
+// Index of the lowest set bit (v != 0)
+static inline int ctz32(uint32_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(v);
+#else
+    int n = 0;
+    for (; !(v & 1u); v >>= 1) ++n;
+    return n;
+#endif
+}
+
+static uint32_t aabbMaskScalar(const Rectangle& r, const float* minX, const float* minY,
+                               const float* maxX, const float* maxY, int n) {
+    float rx1 = r.x + r.width, ry1 = r.y + r.height;
+    uint32_t m = 0;
+    for (int i = 0; i < n; ++i)
+        if (r.x < maxX[i] && rx1 > minX[i] && r.y < maxY[i] && ry1 > minY[i]) m |= 1u << i;
+    return m;
+}
+
+// 8 boxes per step with AVX, 4 with SSE2, scalar for the tail. Ordered
+// compares, so a NaN coordinate never hits, as in the scalar test.
+static uint32_t aabbMask(const Rectangle& r, const float* minX, const float* minY,
+                         const float* maxX, const float* maxY, int n) {
+    int i = 0;
+    uint32_t m = 0;
+#if defined(__AVX__)
+    {
+        const __m256 x0 = _mm256_set1_ps(r.x), x1 = _mm256_set1_ps(r.x + r.width);
+        const __m256 y0 = _mm256_set1_ps(r.y), y1 = _mm256_set1_ps(r.y + r.height);
+        for (; i + 8 <= n; i += 8) {
+            __m256 hx = _mm256_and_ps(_mm256_cmp_ps(x0, _mm256_loadu_ps(maxX + i), _CMP_LT_OQ),
+                                      _mm256_cmp_ps(x1, _mm256_loadu_ps(minX + i), _CMP_GT_OQ));
+            __m256 hy = _mm256_and_ps(_mm256_cmp_ps(y0, _mm256_loadu_ps(maxY + i), _CMP_LT_OQ),
+                                      _mm256_cmp_ps(y1, _mm256_loadu_ps(minY + i), _CMP_GT_OQ));
+            m |= (uint32_t)_mm256_movemask_ps(_mm256_and_ps(hx, hy)) << i;
+        }
+    }
+#endif
+#if GX_SOFT_SSE2
+    {
+        const __m128 x0 = _mm_set1_ps(r.x), x1 = _mm_set1_ps(r.x + r.width);
+        const __m128 y0 = _mm_set1_ps(r.y), y1 = _mm_set1_ps(r.y + r.height);
+        for (; i + 4 <= n; i += 4) {
+            __m128 hx = _mm_and_ps(_mm_cmplt_ps(x0, _mm_loadu_ps(maxX + i)),
+                                   _mm_cmpgt_ps(x1, _mm_loadu_ps(minX + i)));
+            __m128 hy = _mm_and_ps(_mm_cmplt_ps(y0, _mm_loadu_ps(maxY + i)),
+                                   _mm_cmpgt_ps(y1, _mm_loadu_ps(minY + i)));
+            m |= (uint32_t)_mm_movemask_ps(_mm_and_ps(hx, hy)) << i;
+        }
+    }
+#endif
+    if (i < n) m |= aabbMaskScalar(r, minX + i, minY + i, maxX + i, maxY + i, n - i) << i;
+    return m;
+}
+
+// A rectangle over one tick: where it started and how far it moved
+struct Sweep {
+    Rectangle r0;
+    Vector2   d;
+};
+
+static Rectangle sweepBounds(const Sweep& s) {
+    float x0 = std::min(s.r0.x, s.r0.x + s.d.x), y0 = std::min(s.r0.y, s.r0.y + s.d.y);
+    return { x0, y0, s.r0.width + std::fabs(s.d.x), s.r0.height + std::fabs(s.d.y) };
+}
+
+// Continuous test for two rectangles moving over one tick. Returns the
+// earliest tick fraction in [0, 1] at which they overlap, or -1. Per axis
+// the relative motion must satisfy lo < s*d < hi with the same strict
+// comparisons as CheckCollisionRecs; at s = 0 the answer is identical to it,
+// since a < b and b - a > 0 agree in IEEE arithmetic.
+static float sweptOverlap(const Sweep& a, const Sweep& b) {
+    float enter = 0.f, exit = 1.f;
+    auto axis = [&](float aMin, float aSize, float bMin, float bSize, float d) {
+        float lo = bMin - (aMin + aSize);
+        float hi = (bMin + bSize) - aMin;
+        if (d == 0.f) {
+            if (!(lo < 0.f && 0.f < hi)) exit = -1.f;
+            return;
+        }
+        float s0 = lo / d, s1 = hi / d;
+        if (d < 0.f) std::swap(s0, s1);
+        enter = std::max(enter, s0);
+        exit  = std::min(exit, s1);
+    };
+    axis(a.r0.x, a.r0.width,  b.r0.x, b.r0.width,  a.d.x - b.d.x);
+    axis(a.r0.y, a.r0.height, b.r0.y, b.r0.height, a.d.y - b.d.y);
+    return enter < exit ? enter : -1.f;
+}
+
+// What a grid entry is; queries take a mask of these
+enum GridKind : uint8_t { GRID_ENEMY = 1, GRID_BOSS = 2, GRID_EBULLET = 4, GRID_POWERUP = 8 };
+
+// Uniform-grid broadphase over the playfield, rebuilt every tick from the
+// collidable entities. Entries go in every cell their rectangle touches;
+// anything off screen is clamped into the border cells, and queries clamp
+// the same way, so nothing is missed. Cells are stored packed (counting
+// sort) with a min/max copy of each rectangle, so a query runs aabbMask
+// over a cell's boxes directly. The buffers keep their capacity, so
+// rebuilds do not allocate once warmed up.
+struct CollisionGrid {
+    static constexpr int CELL  = 48;   // px, about two enemy hitboxes
+    static constexpr int GW    = (SW + CELL - 1) / CELL;
+    static constexpr int GH    = (SH + CELL - 1) / CELL;
+
+    struct Entry {
+        Rectangle rect;
+        uint8_t   kind;
+        uint32_t  key;   // enemy id, pool index...
+    };
+
+    std::vector<Entry>    entries;
+    std::vector<uint32_t> items;                  // entry indices, grouped by cell
+    std::vector<float>    minX, minY, maxX, maxY; // per item, same order
+    std::array<int, GW * GH + 1> cellStart {};
+    std::vector<uint32_t> stamp;                  // per entry: last query that saw it
+    uint32_t              queryId = 0;
+
+    // Truncation is enough: anything left of or above 0 clamps to cell 0
+    static int cellX(float x) { return std::clamp((int)(x * (1.f / CELL)), 0, GW - 1); }
+    static int cellY(float y) { return std::clamp((int)(y * (1.f / CELL)), 0, GH - 1); }
+
+    template <class Fn>
+    static void forCells(const Rectangle& r, Fn fn) {
+        int x0 = cellX(r.x), x1 = cellX(r.x + r.width);
+        int y0 = cellY(r.y), y1 = cellY(r.y + r.height);
+        for (int cy = y0; cy <= y1; ++cy)
+            for (int cx = x0; cx <= x1; ++cx) fn(cy * GW + cx);
+    }
+
+    void clear() { entries.clear(); }
+
+    void add(const Rectangle& r, uint8_t kind, int key) {
+        entries.push_back({r, kind, (uint32_t)key});
+    }
+
+    void build() {
+        cellStart.fill(0);
+        for (const Entry& e : entries)
+            forCells(e.rect, [&](int c) { ++cellStart[c + 1]; });
+        for (int c = 0; c < GW * GH; ++c) cellStart[c + 1] += cellStart[c];
+        int total = cellStart[GW * GH];
+        items.resize(total);
+        minX.resize(total); minY.resize(total);
+        maxX.resize(total); maxY.resize(total);
+        std::array<int, GW * GH> fill;
+        std::copy_n(cellStart.begin(), GW * GH, fill.begin());
+        for (int i = 0; i < (int)entries.size(); ++i) {
+            const Rectangle& r = entries[i].rect;
+            forCells(r, [&](int c) {
+                int k = fill[c]++;
+                items[k] = (uint32_t)i;
+                minX[k] = r.x;           minY[k] = r.y;
+                maxX[k] = r.x + r.width; maxY[k] = r.y + r.height;
+            });
+        }
+        if (stamp.size() < entries.size()) stamp.resize(entries.size(), 0);   // older stamps never match
+    }
+
+    // Calls fn(entry) once for every entry of a kind in mask that overlaps r
+    template <class Fn>
+    void query(const Rectangle& r, uint32_t mask, Fn&& fn) {
+        uint32_t q = ++queryId;
+        forCells(r, [&](int c) {
+            for (int k0 = cellStart[c]; k0 < cellStart[c + 1]; k0 += AABB_BATCH) {
+                int n = std::min(AABB_BATCH, cellStart[c + 1] - k0);
+                for (uint32_t hits = aabbMask(r, &minX[k0], &minY[k0], &maxX[k0], &maxY[k0], n); hits; hits &= hits - 1) {
+                    int i = items[k0 + ctz32(hits)];
+                    const Entry& e = entries[i];
+                    if (!(e.kind & mask) || stamp[i] == q) continue;
+                    stamp[i] = q;
+                    fn(e);
+                }
+            }
+        });
+    }
+};
+
+// Every enemy, the boss and full enemy bullet and power-up pools: the most
+// a game (or --stress) can put in the grid
+static constexpr uint64_t GRID_MAX_ENTRIES = (uint64_t)ENEMY_CAPACITY + 1 + 2ull * POOL_MAX_CAPACITY;
+static_assert(GRID_MAX_ENTRIES <= UINT32_MAX, "grid entries are indexed with uint32_t");
+
+// Snapshot header: magic, format version and a fingerprint of the struct
+// layouts, so a buffer from an incompatible build is rejected, not misread.
+static constexpr uint32_t SNAPSHOT_MAGIC   = 0x53535847;   // "GXSS"
+static constexpr uint32_t SNAPSHOT_VERSION = 7;
+
+static uint32_t snapshotLayoutTag();
+
+// Balance knobs, overridable from the command line for offline sweeps.
+// Defaults reproduce the shipped difficulty curve.
+struct GameTuning {
+    float diveInterval    = 2.2f;   // s between dive groups in round 1
+    float diveIntervalMin = 1.0f;
+    float speedScale      = 1.f;    // scales the speedFactor() ramp
+    float bossHpScale     = 1.f;
+
+    // Formation grid (classic 10 x 4 holds 26 ships; up to 64 x 64)
+    int   formCols        = 10;
+    int   formRows        = 4;
+
+    // Pool capacities (spawns beyond these are dropped and counted)
+    int   playerBulletCap = 64;
+    int   enemyBulletCap  = 128;
+    int   powerUpCap      = 8;
+};
+
 // ─────────────────────────────────────────────────────────────
 //  GAME  (all state in one struct for clarity)
 // ─────────────────────────────────────────────────────────────
@@ -713,16 +2239,25 @@ struct Game {
     GameState  state      = GameState::ATTRACT;
     StarField  stars;
     Player     player;
-
-    std::vector<Enemy>  enemies;
-    std::vector<Bullet> pBullets;   // player bullets
-    std::vector<Bullet> eBullets;   // enemy bullets
-    std::vector<PowerUp> powerUps;
+    Player     player2;              // segunda nave (solo en cooperativo)
+    bool       coop       = false;
+    Effects    fx;
+    EnemyAnim  anim;
+    GameRng    rng;
+    GameTuning tuning;
+
+    EnemyStore          enemies;
+    CollisionGrid       grid;           // broadphase, rebuilt every tick (not state)
+    std::vector<uint32_t> pickHits;     // scratch for pickPowerUps
+    FixedPool<Bullet>   pBullets;   // player bullets
+    FixedPool<Bullet>   eBullets;   // enemy bullets
+    FixedPool<PowerUp>  powerUps;
     Boss               boss;
 
     int    score       = 0;
     int    highScore   = 0;
     int    round       = 1;
+    int    deaths[(int)DeathCause::COUNT] = {};   // lives lost, by cause
 
     // Formation motion
     float  formVX      = 30.f;   // current lateral speed (px/s)
@@ -730,6 +2265,16 @@ struct Game {
     float  formOffY    = 0.f;    // sine vertical offset
     float  formSineT   = 0.f;
 
+    // Formation slots, derived from the fields above by updateFormationSlots()
+    // (not state). Geometry comes from tuning via layoutFormation().
+    float  formCellW   = CELL_W;
+    float  formCellH   = CELL_H;
+    float  formStartX  = 0.f;
+    std::vector<float> slotX;           // per column
+    std::vector<float> slotY;           // per row * formCols + col
+    std::vector<float> waveSin, waveCos;   // per column, this tick
+    std::vector<float> skewSin, skewCos;   // per row, fixed
+    std::vector<uint16_t> diveCandidates;  // scratch for startDive
 
     // Dive timer
     float  diveTimer   = 0.f;
@@ -746,33 +2291,181 @@ struct Game {
     float  flashTimer  = 0.f;
     bool   flashActive = false;
 
+    // Ticks simulated since boot, the hash of the last tick's state and the
+    // running (chained) hash of every tick so far
+    uint32_t tick      = 0;
+    uint64_t stateHash = 0;
+    uint64_t tickHash  = 0;
+
+    // Fracción del tick en curso al dibujar (0 = tick anterior, 1 = actual)
+    float  renderAlpha = 1.f;
+
     // ── helpers ───────────────────────────────────────────────
+    // Arranque en attract a partir de una semilla (misma semilla + mismas
+    // entradas = misma partida)
+    void boot(uint64_t seed) {
+        rng.reseed(seed);
+        stars.init(rng.cosmetic);
+        setRound(1);
+        resetPools();
+        buildFormation();
+    }
+
+    // Sizes the pools from tuning; allocates only when a capacity changes
+    void resetPools() {
+        pBullets.reset(tuning.playerBulletCap);
+        eBullets.reset(tuning.enemyBulletCap);
+        powerUps.reset(tuning.powerUpCap);
+        layoutFormation();
+        enemies.reset(tuning.formRows * tuning.formCols);
+        diveCandidates.resize(enemies.capacity());
+    }
+
+    // Cell size and per-row constants for the tuned formation size
+    void layoutFormation() {
+        tuning.formCols = std::clamp(tuning.formCols, 2, FORM_MAX_COLS);
+        tuning.formRows = std::clamp(tuning.formRows, 1, FORM_MAX_ROWS);
+        int cols = tuning.formCols, rows = tuning.formRows;
+        formCellW  = std::min(CELL_W, (SW - 40.f) / cols);
+        formCellH  = std::min(CELL_H, FORM_MAX_H / rows);
+        formStartX = (SW - cols * formCellW) / 2.f;
+        slotX.resize(cols);
+        slotY.resize(rows * cols);
+        waveSin.resize(cols);
+        waveCos.resize(cols);
+        skewSin.resize(rows);
+        skewCos.resize(rows);
+        for (int r = 0; r < rows; ++r) {
+            skewSin[r] = sinf(r * FORM_ROW_SKEW);
+            skewCos[r] = cosf(r * FORM_ROW_SKEW);
+        }
+        updateFormationSlots();
+    }
+
     void init() {
-        stars.init();
+        stars.init(rng.cosmetic);
         score   = 0;
         round   = 1;
         formVX  = 30.f;
-        player.x = SW / 2.f;
-        player.vx = 0.f;
-        player.lives = 3;
-        player.shotLevel = 1;
-        player.shotCooldown = 0.22f;
-        player.shotTimer = 0.f;
-        player.alive = true;
-        player.invincible = false;
-        pBullets.clear();
-        eBullets.clear();
-        powerUps.clear();
-        gParticles.clear();
-        gFlashes.clear();
-        gDebris.clear();
-        gShake = 0.f;
+        for (int i = 0; i < shipCount(); ++i) {
+            Player& p = ship(i);
+            p.x = homeX(i);
+            p.prevX = p.x;
+            p.vx = 0.f;
+            p.lives = 3;
+            p.shotLevel = 1;
+            p.shotCooldown = 0.22f;
+            p.shotTimer = 0.f;
+            p.alive = true;
+            p.invincible = false;
+        }
+        resetPools();
+        fx.clear();
         buildFormation();
     }
 
-    void buildFormation() {
-        enemies.clear();
-        pBullets.clear();
+    // Nueva partida empezando directamente en la ronda r
+    void startAtRound(int r) {
+        init();
+        setRound(std::max(1, r));
+        buildFormation();
+        state = GameState::PLAYING;
+    }
+
+    // Naves en juego: player, y player2 en cooperativo
+    int shipCount() const { return coop ? 2 : 1; }
+    Player&       ship(int i)       { return i == 0 ? player : player2; }
+    const Player& ship(int i) const { return i == 0 ? player : player2; }
+    float homeX(int i) const { return coop ? SW * (i + 1) / 3.f : SW / 2.f; }
+
+    // Nave a la que apuntan los enemigos en x: la viva más cercana
+    const Player& targetFor(float x) const {
+        if (!coop || !player2.alive) return player;
+        if (!player.alive) return player2;
+        return std::fabs(player2.x - x) < std::fabs(player.x - x) ? player2 : player;
+    }
+
+    void setRound(int r) {
+        round = r;
+        formVX = 30.f + (round-1) * 5.f;
+        diveInterval = std::max(tuning.diveIntervalMin, tuning.diveInterval - (round-1)*0.15f);
+    }
+
+    // ── snapshots ─────────────────────────────────────────────
+    // Every field that the simulation reads goes through here, for both
+    // directions, so save and restore can never drift apart.
+    template <class G, class Ar>
+    static void serializeState(G& g, Ar& ar) {
+        ar.pod(g.state);
+        ar.pod(g.stars);
+        ar.pod(g.player);
+        ar.pod(g.player2);
+        ar.pod(g.coop);
+        ar.pod(g.anim);
+        ar.pod(g.rng);
+        ar.pod(g.tuning);
+        ar.pod(g.deaths);
+        ParticlePool::serialize(g.fx.particles, ar);
+        FlashPool::serialize(g.fx.flashes, ar);
+        DebrisPool::serialize(g.fx.debris, ar);
+        ar.pod(g.fx.shake);
+        ar.pod(g.fx.overflow);
+        EnemyStore::serialize(g.enemies, ar);
+        FixedPool<Bullet>::serialize(g.pBullets, ar);
+        FixedPool<Bullet>::serialize(g.eBullets, ar);
+        FixedPool<PowerUp>::serialize(g.powerUps, ar);
+        ar.pod(g.boss);
+        ar.pod(g.score);
+        ar.pod(g.highScore);
+        ar.pod(g.round);
+        ar.pod(g.formVX);
+        ar.pod(g.formOffX);
+        ar.pod(g.formOffY);
+        ar.pod(g.formSineT);
+        ar.pod(g.diveTimer);
+        ar.pod(g.diveInterval);
+        ar.pod(g.stateTimer);
+        ar.pod(g.blinkTimer);
+        ar.pod(g.blinkOn);
+        ar.pod(g.flashTimer);
+        ar.pod(g.flashActive);
+        ar.pod(g.tick);
+        ar.pod(g.stateHash);
+        ar.pod(g.tickHash);
+    }
+
+    // Appends nothing: out is overwritten, but its capacity is reused, so
+    // repeated saves into the same buffer do not allocate.
+    void saveState(std::vector<uint8_t>& out) const {
+        out.clear();
+        SnapshotWriter w{out};
+        w.pod(SNAPSHOT_MAGIC);
+        w.pod(SNAPSHOT_VERSION);
+        w.pod(snapshotLayoutTag());
+        serializeState(*this, w);
+    }
+
+    // Restores in place (vector capacity is reused). A buffer that passes the
+    // header check but is truncated leaves the game half-restored: reboot it.
+    bool loadState(const uint8_t* data, size_t size) {
+        SnapshotReader r{data, data + size};
+        uint32_t magic = 0, version = 0, layout = 0;
+        r.pod(magic);
+        r.pod(version);
+        r.pod(layout);
+        if (!r.ok || magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION || layout != snapshotLayoutTag())
+            return false;
+        serializeState(*this, r);
+        layoutFormation();
+        diveCandidates.resize(enemies.capacity());
+        return r.ok && r.p == r.end;
+    }
+
+    bool loadState(const std::vector<uint8_t>& buf) { return loadState(buf.data(), buf.size()); }
+
+    void buildFormation() {
+        enemies.clear();
+        pBullets.clear();
         eBullets.clear();
         powerUps.clear();
         boss = {};
@@ -786,12 +2479,13 @@ struct Game {
             boss.active = true;
             boss.x = SW * 0.5f;
             boss.y = 130.f;
+            boss.prevX = boss.x;
             int bossLevel = round / 3;  // 1, 2, 3...
             boss.vx = 110.f + bossLevel * 22.f;   // más rápido cada boss
             boss.size = 96.f;
             boss.shotInterval = std::max(0.28f, 1.2f - bossLevel * 0.10f);  // dispara más rápido
             boss.shotTimer = 0.4f;
-            boss.maxHp = 10 + bossLevel * 5;       // mucho más vida
+            boss.maxHp = std::max(1, (int)std::lround((10 + bossLevel * 5) * tuning.bossHpScale));  // mucho más vida
             boss.hp = boss.maxHp;
             switch (cycle) {
                 case 0: boss.type = EnemyType::FLAGSHIP; break;  // enemy1
@@ -801,227 +2495,295 @@ struct Game {
             return;
         }
 
-        static const EnemyType rowType[ROWS] = {
-            EnemyType::ZAKO_GREEN, // enemy3 (arriba)
-            EnemyType::ZAKO_GREEN, // enemy3 (arriba)
-            EnemyType::ZAKO_BLUE,  // enemy2 (medio)
-            EnemyType::ESCORT      // enemy1 (abajo)
-        };
-
-        static const int rowCount[ROWS] = {2, 6, 8, 10};
-
-        for (int r = 0; r < ROWS; ++r) {
-            int count = rowCount[r];
-            int startCol = (COLS - count) / 2;
+        // Bottom row enemy1, the one above enemy2, the rest enemy3. The top
+        // three rows taper (10 x 4 gives the classic 2, 6, 8, 10).
+        static const int taper[3] = {8, 4, 2};
+        int rows = tuning.formRows, cols = tuning.formCols;
+        for (int r = 0; r < rows; ++r) {
+            EnemyType type = r == rows - 1 ? EnemyType::ESCORT       // enemy1 (abajo)
+                           : r == rows - 2 ? EnemyType::ZAKO_BLUE    // enemy2 (medio)
+                           :                 EnemyType::ZAKO_GREEN;  // enemy3 (arriba)
+            int count = std::max(std::min(2, cols), cols - (r < 3 ? taper[r] : 0));
+            int startCol = (cols - count) / 2;
             for (int i = 0; i < count; ++i) {
                 int c = startCol + i;
-                Enemy e;
-                e.type  = rowType[r];
-                e.row   = r;
-                e.col   = c;
-                e.formX = FORM_START_X + c * CELL_W + CELL_W/2.f;
-                e.formY = FORM_START_Y + r * CELL_H + CELL_H/2.f;
-                e.x     = e.formX;
-                e.y     = e.formY;
-                e.alive = true;
-                e.state = EnemyState::IN_FORMATION;
-                enemies.push_back(e);
+                enemies.add(type, r, c,
+                            formStartX + c * formCellW + formCellW/2.f,
+                            FORM_START_Y + r * formCellH + formCellH/2.f);
             }
         }
     }
 
-    int aliveCount() const {
-        int n = 0;
-        for (const auto& e : enemies) if (e.alive) ++n;
-        return n;
+    // Hash of the gameplay state after a tick (cosmetic effects excluded).
+    uint64_t checksum() const {
+        StateHasher h;
+        h.i((int)state);
+        h.i(score);
+        h.i(round);
+        h.f(player.x);
+        h.f(player.vx);
+        h.i(player.lives);
+        if (coop) {
+            h.f(player2.x);
+            h.f(player2.vx);
+            h.i(player2.lives);
+        }
+        h.f(formOffX);
+        h.i(boss.active ? boss.hp : -1);
+        h.f(boss.x);
+        // By id, so the hash does not depend on partition order
+        h.i(enemies.count);
+        for (int k = 0; k < enemies.count; ++k) {
+            int i = enemies.pos[k];
+            h.i(enemies.isAlive(i) ? (int)enemies.state(i) : -1);
+            h.f(enemies.x[i]);
+            h.f(enemies.y[i]);
+        }
+        h.i((int)pBullets.size());
+        for (const auto& b : pBullets) { h.f(b.x); h.f(b.y); }
+        h.i((int)eBullets.size());
+        for (const auto& b : eBullets) { h.f(b.x); h.f(b.y); }
+        h.word((uint32_t)rng.gameplay.counter);
+        return h.digest();
     }
 
-    // Formation base position (accounts for lateral offset)
-    float formationX(int col) const {
-        return FORM_START_X + col * CELL_W + CELL_W/2.f + formOffX;
-    }
-    float formationY(int row, int col) const {
+    int aliveCount() const { return enemies.aliveCount(); }
+
+    // Formation base position (accounts for lateral offset and the wave)
+    float formationX(int col) const { return slotX[col]; }
+    float formationY(int row, int col) const { return slotY[row * tuning.formCols + col]; }
+
+    // Every slot position for this tick. The column wave
+    // sin(t + col*P + row*S) = sin(t + col*P) cos(row*S) + cos(t + col*P) sin(row*S)
+    // splits into per-column and per-row terms, so a tick costs 2*cols + rows
+    // sinf calls and each row is two vector axpys over the columns.
+    void updateFormationSlots() {
+        int rows = tuning.formRows, cols = tuning.formCols;
         // Tie wave phase to both time and lateral offset to avoid phase jumps at edge bounces.
         float t = formSineT * FORM_BOB_FREQ + formOffX * 0.08f;
-        float rowBob = sinf(t + row * FORM_ROW_PHASE) * FORM_ROW_AMP;
-        float colWave = sinf(t + col * FORM_COL_PHASE + row * 0.25f) * FORM_COL_AMP;
-        return FORM_START_Y + row * CELL_H + CELL_H/2.f + formOffY + rowBob + colWave;
+        for (int c = 0; c < cols; ++c) {
+            slotX[c]   = formStartX + c * formCellW + formCellW/2.f + formOffX;
+            waveSin[c] = sinf(t + c * FORM_COL_PHASE) * FORM_COL_AMP;
+            waveCos[c] = cosf(t + c * FORM_COL_PHASE) * FORM_COL_AMP;
+        }
+        for (int r = 0; r < rows; ++r) {
+            float* y = slotY.data() + r * cols;
+            float rowBob = sinf(t + r * FORM_ROW_PHASE) * FORM_ROW_AMP;
+            std::fill(y, y + cols, FORM_START_Y + r * formCellH + formCellH/2.f + formOffY + rowBob);
+            fxAxpy(y, waveSin.data(), skewCos[r], cols);
+            fxAxpy(y, waveCos.data(), skewSin[r], cols);
+        }
     }
 
-    // Speed factor based on enemies killed
+    // Speed factor based on the share of the formation killed (boss rounds
+    // count as cleared). A full clear adds 0.208, as 26 kills did at 0.008.
     float speedFactor() const {
-        int total = 26;
-        int killed = total - aliveCount();
-        return 1.f + killed * 0.008f + (round - 1) * 0.1f;
+        float cleared = enemies.count > 0 ? 1.f - (float)aliveCount() / (float)enemies.count : 1.f;
+        return 1.f + (cleared * 0.208f + (round - 1) * 0.1f) * tuning.speedScale;
     }
 
     // ── start a dive group ────────────────────────────────────
     void startDive() {
-        // Find living in-formation enemies
-        std::vector<Enemy*> candidates;
-        for (auto& e : enemies)
-            if (e.alive && e.state == EnemyState::IN_FORMATION)
-                candidates.push_back(&e);
-
-        if (candidates.empty()) return;
+        // Living in-formation enemies, by id so the choice does not depend on
+        // partition order (fixed buffers: rollback re-runs this inside a
+        // frame and must not allocate)
+        std::vector<uint16_t>& candidates = diveCandidates;
+        int candCount = 0;
+        for (int i = 0; i < enemies.formEnd; ++i)
+            candidates[candCount++] = enemies.id[i];
+        std::sort(candidates.begin(), candidates.begin() + candCount);
+
+        if (candCount == 0) return;
+        auto at = [&](uint16_t id) { return enemies.pos[id]; };
 
         // Try to launch Flagship + escorts
-        Enemy* flagship = nullptr;
-        for (auto* e : candidates)
-            if (e->type == EnemyType::FLAGSHIP) { flagship = e; break; }
+        int flagship = -1;
+        for (int i = 0; i < candCount; ++i)
+            if (enemies.type[at(candidates[i])] == EnemyType::FLAGSHIP) { flagship = candidates[i]; break; }
 
-        std::vector<Enemy*> group;
+        std::array<uint16_t, 3> group;
+        int groupCount = 0;
 
-        if (flagship && GetRandomValue(0,1) == 0) {
-            group.push_back(flagship);
+        if (flagship >= 0 && rng.gameplay.range(0, 1) == 0) {
+            group[groupCount++] = (uint16_t)flagship;
+            int flagCol = enemies.col[at((uint16_t)flagship)];
             // Find escort neighbours (row 1, same or adjacent cols)
-            for (auto* e : candidates) {
-                if (e->type == EnemyType::ESCORT &&
-                    std::abs(e->col - flagship->col) <= 2 &&
-                    (int)group.size() < 3)
-                    group.push_back(e);
+            for (int i = 0; i < candCount; ++i) {
+                int e = at(candidates[i]);
+                if (enemies.type[e] == EnemyType::ESCORT &&
+                    std::abs(enemies.col[e] - flagCol) <= 2 &&
+                    groupCount < 3)
+                    group[groupCount++] = candidates[i];
             }
         } else {
             // 1-3 Zakos según ronda
-            std::shuffle(candidates.begin(), candidates.end(),
-                std::default_random_engine(GetRandomValue(0,99999)));
+            for (int i = candCount - 1; i > 0; --i)
+                std::swap(candidates[i], candidates[rng.gameplay.range(0, i)]);
             int maxCnt = (round >= 4) ? 3 : (round >= 2 ? 2 : 1);
-            int cnt = GetRandomValue(1, maxCnt);
-            for (int i = 0; i < cnt && i < (int)candidates.size(); ++i)
-                group.push_back(candidates[i]);
+            int cnt = rng.gameplay.range(1, maxCnt);
+            for (int i = 0; i < cnt && i < candCount; ++i)
+                group[groupCount++] = candidates[i];
         }
 
-        for (auto* e : group) {
-            launchDive(*e);
+        // Launching reorders the formation range, so look each one up by id
+        for (int i = 0; i < groupCount; ++i) {
+            launchDive(enemies.pos[group[i]]);
         }
     }
 
-    void launchDive(Enemy& e) {
-        e.state = EnemyState::DIVING;
-        e.t     = 0.f;
-        e.diveSpeed = (e.type == EnemyType::FLAGSHIP ? 190.f : 210.f) * speedFactor();
+    void launchDive(int i) {
+        i = enemies.moveTo(i, EnemyState::DIVING);
+        EnemyPath& e = enemies.pathAt(i);
+        EnemyType type = enemies.type[i];
+        e.dist  = 0.f;
+        e.diveSpeed = (type == EnemyType::FLAGSHIP ? 190.f : 210.f) * speedFactor();
 
         // Bezier: start at current pos, arc up then down toward player
-        float startX = e.x, startY = e.y;
+        float startX = enemies.x[i], startY = enemies.y[i];
         float side   = (startX < SW/2.f) ? 1.f : -1.f;
 
+        // Stream propio de esta picada: (ronda, slot, nº de picada)
+        RngStream erng = rng.entity(((uint64_t)round << 16) | (uint64_t)(enemies.row[i] * tuning.formCols + enemies.col[i]),
+                                    enemies.dives[i]++);
+
         float aimError = 0.f;
-        switch (e.type) {
-            case EnemyType::FLAGSHIP: aimError = (float)GetRandomValue(-36, 36); break;
-            case EnemyType::ESCORT:   aimError = (float)GetRandomValue(-52, 52); break;
-            default:                  aimError = (float)GetRandomValue(-70, 70); break;
+        switch (type) {
+            case EnemyType::FLAGSHIP: aimError = (float)erng.range(-36, 36); break;
+            case EnemyType::ESCORT:   aimError = (float)erng.range(-52, 52); break;
+            default:                  aimError = (float)erng.range(-70, 70); break;
         }
-        e.diveTargetX = std::clamp(player.x + aimError, 24.f, SW - 24.f);
+        e.diveTargetX = std::clamp(targetFor(startX).x + aimError, 24.f, SW - 24.f);
 
         e.p0 = {startX, startY};
         e.p1 = {startX + side*120.f, startY - 80.f};   // up and outward
         e.p2 = {e.diveTargetX + side*70.f, PLAYER_Y - 200.f};
         e.p3 = {e.diveTargetX, (float)SH + 60.f};      // fixed target (no homing)
+        e.lut.build(e.p0, e.p1, e.p2, e.p3);
 
         // Bullets setup — escalan con la ronda
         float roundMult = std::max(0.55f, 1.f - (round - 1) * 0.08f); // intervalo se reduce
-        if (e.type == EnemyType::FLAGSHIP) {
+        if (type == EnemyType::FLAGSHIP) {
             e.bulletsLeft  = 2 + std::min(round - 1, 2);  // 2-4
             e.shootInterval = 0.4f * roundMult;
-        } else if (e.type == EnemyType::ESCORT) {
+        } else if (type == EnemyType::ESCORT) {
             e.bulletsLeft  = 1 + std::min(round / 2, 2);  // 1-3
             e.shootInterval = 0.5f * roundMult;
         } else {
-            e.bulletsLeft  = GetRandomValue(1, 1 + std::min(round / 2, 2)); // 1-3
+            e.bulletsLeft  = erng.range(1, 1 + std::min(round / 2, 2)); // 1-3
             e.shootInterval = 0.6f * roundMult;
         }
         e.shootTimer = e.shootInterval * 0.5f;
     }
 
-    void returnToFormation(Enemy& e) {
-        e.state = EnemyState::RETURNING;
-        e.retT  = 0.f;
+    // Returns the enemy's new position (now in the returning range)
+    int returnToFormation(int i) {
+        i = enemies.moveTo(i, EnemyState::RETURNING);
+        EnemyPath& e = enemies.pathAt(i);
+        float x = enemies.x[i];
+        int   row = enemies.row[i], col = enemies.col[i];
+        e.dist  = 0.f;
         // Fly back up from bottom, looping around edge
-        float side = (e.x < SW/2.f) ? -1.f : 1.f;
-        e.retP0 = {e.x,    (float)SH + 40.f};
-        e.retP1 = {e.x + side*160.f, SH/2.f};
-        e.retP2 = {formationX(e.col), FORM_START_Y - 80.f};
-        e.retP3 = {formationX(e.col), formationY(e.row, e.col)};
+        float side = (x < SW/2.f) ? -1.f : 1.f;
+        e.retP0 = {x,    (float)SH + 40.f};
+        e.retP1 = {x + side*160.f, SH/2.f};
+        e.retP2 = {formationX(col), FORM_START_Y - 80.f};
+        e.retP3 = {formationX(col), formationY(row, col)};
+        e.lut.build(e.retP0, e.retP1, e.retP2, e.retP3);
+        return i;
     }
 
-    void firePlayerShot(float offsetX) {
+    void firePlayerShot(const Player& p, float offsetX) {
         Bullet b;
-        b.active = true;
         b.enemy  = false;
-        b.x = player.x + offsetX;
-        b.y = player.y - 14.f;
+        b.x = p.x + offsetX;
+        b.y = p.y - 14.f;
         b.vx = 0.f;
         b.vy = -BULLET_SPEED;
-        pBullets.push_back(b);
+        b.prevX = b.x;
+        b.prevY = b.y;
+        pBullets.push(b);
     }
 
     void spawnPowerUp(float x, float y) {
-        if (GetRandomValue(0, 99) > 7) return; // ~8% drop chance
+        if (rng.gameplay.range(0, 99) > 7) return; // ~8% drop chance
         PowerUp p;
         p.x = x;
         p.y = y;
-        int roll = GetRandomValue(0, 99);
+        int roll = rng.gameplay.range(0, 99);
         if (roll < 50) p.type = PowerUpType::FIRE_RATE;
         else if (roll < 80) p.type = PowerUpType::DOUBLE_SHOT;
         else p.type = PowerUpType::TRIPLE_SHOT;
-        powerUps.push_back(p);
+        powerUps.push(p);
     }
 
-    void applyPowerUp(PowerUpType type) {
-        player.hasPowerUp       = true;
-        player.activePowerUp    = type;
+    void applyPowerUp(Player& p, PowerUpType type) {
+        p.hasPowerUp       = true;
+        p.activePowerUp    = type;
         // Duración base 8s, se reduce 0.4s por ronda (mínimo 3s)
         float dur = std::max(3.f, 8.f - (round - 1) * 0.4f);
-        player.powerUpMaxDuration = dur;
-        player.powerUpTimer       = dur;
+        p.powerUpMaxDuration = dur;
+        p.powerUpTimer       = dur;
         switch (type) {
             case PowerUpType::FIRE_RATE:
-                player.shotCooldown = 0.10f;
+                p.shotCooldown = 0.10f;
                 break;
             case PowerUpType::DOUBLE_SHOT:
-                player.shotLevel = 2;
+                p.shotLevel = 2;
                 break;
             case PowerUpType::TRIPLE_SHOT:
-                player.shotLevel = 3;
+                p.shotLevel = 3;
                 break;
         }
     }
 
-    void expirePowerUp() {
-        player.hasPowerUp   = false;
-        player.shotLevel    = 1;
-        player.shotCooldown = 0.22f;
+    static void expirePowerUp(Player& p) {
+        p.hasPowerUp   = false;
+        p.shotLevel    = 1;
+        p.shotCooldown = 0.22f;
     }
 
     // ── update ────────────────────────────────────────────────
-    void update(float dt) {
+    // Guarda las posiciones actuales antes de avanzar un tick; draw() interpola
+    // entre ellas y las nuevas con renderAlpha.
+    void storePrevious() {
+        player.prevX  = player.x;
+        player2.prevX = player2.x;
+        boss.prevX   = boss.x;
+        std::copy_n(enemies.x.begin(), enemies.count, enemies.prevX.begin());
+        std::copy_n(enemies.y.begin(), enemies.count, enemies.prevY.begin());
+        for (auto& b : pBullets) { b.prevX = b.x; b.prevY = b.y; }
+        for (auto& b : eBullets) { b.prevX = b.x; b.prevY = b.y; }
+    }
+
+    // in2 drives player2 and is ignored outside co-op
+    void update(float dt, const InputFrame& in, const InputFrame& in2 = {}) {
+        storePrevious();
         stars.update(dt);
-        updateParticles(dt);
+        fx.update(dt);
 
         // Animación de enemigos
-        gEnemyAnimTimer += dt;
-        if (gEnemyAnimTimer >= ENEMY_ANIM_INTERVAL) {
-            gEnemyAnimTimer -= ENEMY_ANIM_INTERVAL;
-            gEnemyAnimFrame = (gEnemyAnimFrame + 1) % 3;
-        }
-        gEnemy2Time += dt;
-        gEnemy3Time += dt;
+        anim.update(dt);
 
         switch (state) {
-            case GameState::ATTRACT:   updateAttract(dt);  break;
-            case GameState::PLAYING:   updatePlaying(dt);  break;
+            case GameState::ATTRACT:   updateAttract(dt, in, in2);  break;
+            case GameState::PLAYING:   updatePlaying(dt, in, in2);  break;
             case GameState::PLAYER_DEAD: updateDead(dt);   break;
             case GameState::GAME_OVER: updateGameOver(dt); break;
             case GameState::STAGE_CLEAR: updateClear(dt);  break;
         }
+
+        // Chained: one diverging tick changes every hash after it
+        ++tick;
+        stateHash = checksum();
+        tickHash  = mix64(tickHash ^ stateHash);
     }
 
-    void updateAttract(float dt) {
+    void updateAttract(float dt, const InputFrame& in, const InputFrame& in2) {
         updateFormationMotion(dt);
         blinkTimer += dt;
         if (blinkTimer >= 0.5f) { blinkTimer = 0.f; blinkOn = !blinkOn; }
 
-        if (IsKeyPressed(KEY_ENTER) || IsKeyPressed(KEY_SPACE)) {
+        if (in.start || (coop && in2.start)) {
             init();
             state = GameState::PLAYING;
         }
@@ -1031,16 +2793,26 @@ struct Game {
         stateTimer -= dt;
         stars.update(dt);
         if (stateTimer <= 0.f) {
-            if (player.lives <= 0) {
+            // Reaparecen las naves caídas que aún tienen vidas; en cooperativo
+            // la partida sigue mientras quede alguna
+            bool anyAlive = false;
+            for (int i = 0; i < shipCount(); ++i) {
+                Player& p = ship(i);
+                if (!p.alive && p.lives > 0) {
+                    p.x = homeX(i);
+                    p.prevX = p.x;
+                    p.vx = 0.f;
+                    p.alive = true;
+                    p.invincible = true;
+                    p.invTimer   = 2.f;
+                }
+                anyAlive |= p.alive;
+            }
+            if (!anyAlive) {
                 state = GameState::GAME_OVER;
                 stateTimer = 3.f;
             } else {
-                player.x = SW / 2.f;
-                player.vx = 0.f;
-                player.alive = true;
                 pBullets.clear();
-                player.invincible = true;
-                player.invTimer   = 2.f;
                 state = GameState::PLAYING;
             }
         }
@@ -1058,15 +2830,15 @@ struct Game {
         stateTimer -= dt;
         flashTimer += dt;
         if (stateTimer <= 0.f) {
-            round++;
-            formVX = 30.f + (round-1) * 5.f;
-            diveInterval = std::max(1.0f, 2.2f - (round-1)*0.15f);
+            setRound(round + 1);
             buildFormation();
             state = GameState::PLAYING;
         }
     }
 
-    void updatePlaying(float dt) {
+    void updateShip(Player& player, float dt, const InputFrame& in) {
+        if (!player.alive) return;   // cooperativo: nave sin vidas
+
         // Invincibility
         if (player.invincible) {
             player.invTimer -= dt;
@@ -1077,15 +2849,15 @@ struct Game {
         // Power-up timer
         if (player.hasPowerUp) {
             player.powerUpTimer -= dt;
-            if (player.powerUpTimer <= 0.f) expirePowerUp();
+            if (player.powerUpTimer <= 0.f) expirePowerUp(player);
         }
 
         player.thrusterTime += dt;
 
         // Player movement with acceleration/deceleration ramps
         float moveInput = 0.f;
-        if (IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A)) moveInput -= 1.f;
-        if (IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D)) moveInput += 1.f;
+        if (in.left)  moveInput -= 1.f;
+        if (in.right) moveInput += 1.f;
 
         if (moveInput != 0.f) {
             player.vx += moveInput * PLAYER_ACCEL * dt;
@@ -1107,151 +2879,219 @@ struct Game {
         }
 
         // Player shoot (flanco positivo: solo dispara al pulsar, no al mantener)
-        if (IsKeyPressed(KEY_SPACE) && player.shotTimer <= 0.f) {
+        if (in.fire && player.shotTimer <= 0.f) {
             if (player.shotLevel <= 1) {
-                firePlayerShot(0.f);
+                firePlayerShot(player, 0.f);
             } else if (player.shotLevel == 2) {
-                firePlayerShot(-7.f);
-                firePlayerShot(7.f);
+                firePlayerShot(player, -7.f);
+                firePlayerShot(player, 7.f);
             } else {
-                firePlayerShot(-10.f);
-                firePlayerShot(0.f);
-                firePlayerShot(10.f);
+                firePlayerShot(player, -10.f);
+                firePlayerShot(player, 0.f);
+                firePlayerShot(player, 10.f);
             }
             player.shotTimer = player.shotCooldown;
         }
+    }
+
+    // Motion of each collidable over the current tick, for sweptOverlap.
+    // Bullets and divers sweep from their previous position, so a slow tick
+    // cannot carry them through a hitbox; enemies parked in formation count
+    // as static at their slot (a recall teleports them there).
+    static Sweep bulletSweep(const Bullet& b) {
+        return {b.rectAt(b.prevX, b.prevY), {b.x - b.prevX, b.y - b.prevY}};
+    }
+    Sweep enemySweep(int i) const {
+        if (enemies.state(i) == EnemyState::IN_FORMATION) return {enemies.hitbox(i), {0.f, 0.f}};
+        return {EnemyStore::hitboxAt(enemies.prevX[i], enemies.prevY[i]),
+                {enemies.x[i] - enemies.prevX[i], enemies.y[i] - enemies.prevY[i]}};
+    }
+    Sweep bossSweep() const { return {boss.hitboxAt(boss.prevX), {boss.x - boss.prevX, 0.f}}; }
+
+    // Choques con una nave vulnerable; true si la ha destruido.
+    // Precedence: enemy bullet, then diver body, then boss; within a kind
+    // the earliest contact in the tick wins (ties: lowest index / id).
+    bool hitShip(Player& player) {
+        int   bullet = -1, diver = -1;
+        float bulletT = 2.f, diverT = 2.f;
+        bool  bossHit = false;
+        const auto boxes0 = Player::hitboxes(player.prevX, player.y);
+        const Vector2 move = {player.x - player.prevX, 0.f};
+        for (const Rectangle& box0 : boxes0) {
+            Sweep ship = {box0, move};
+            grid.query(sweepBounds(ship), GRID_EBULLET | GRID_ENEMY | GRID_BOSS, [&](const CollisionGrid::Entry& en) {
+                if (en.kind == GRID_EBULLET) {
+                    float t = sweptOverlap(ship, bulletSweep(eBullets[en.key]));
+                    if (t >= 0.f && (t < bulletT || (t == bulletT && (int)en.key < bullet))) { bulletT = t; bullet = (int)en.key; }
+                } else if (en.kind == GRID_ENEMY) {
+                    int i = enemies.pos[en.key];
+                    if (i < enemies.formEnd || i >= enemies.alive) return;
+                    float t = sweptOverlap(ship, enemySweep(i));
+                    if (t >= 0.f && (t < diverT || (t == diverT && (int)en.key < diver))) { diverT = t; diver = (int)en.key; }
+                } else {
+                    bossHit = bossHit || (boss.active && sweptOverlap(ship, bossSweep()) >= 0.f);
+                }
+            });
+        }
+
+        if (bullet >= 0) {
+            eBullets.remove(bullet);
+            killPlayer(player, DeathCause::BULLET);
+            return true;
+        }
+
+        // Collision: diving/returning enemy body vs player
+        if (diver >= 0) {
+            int i = enemies.pos[diver];
+            fx.spawnExplosion(rng.cosmetic, enemies.x[i], enemies.y[i], false, enemies.type[i]);
+            enemies.kill(i);
+            killPlayer(player, DeathCause::COLLISION);
+            return true;
+        }
+
+        if (bossHit) {
+            killPlayer(player, DeathCause::BOSS);
+            return true;
+        }
+        return false;
+    }
+
+    // Everything the ships and player bullets can hit, as of now, each at
+    // the bounds of its sweep over the tick. Enemy keys are ids (kills
+    // reorder the store); bullet and power-up keys are pool indices, valid
+    // until the pool changes.
+    void buildCollisionGrid() {
+        grid.clear();
+        for (int i = 0; i < enemies.alive; ++i)
+            grid.add(sweepBounds(enemySweep(i)), GRID_ENEMY, enemies.id[i]);
+        if (boss.active) grid.add(sweepBounds(bossSweep()), GRID_BOSS, 0);
+        for (int i = 0; i < eBullets.size(); ++i) grid.add(sweepBounds(bulletSweep(eBullets[i])), GRID_EBULLET, i);
+        for (int i = 0; i < powerUps.size(); ++i) grid.add(powerUps[i].rect(), GRID_POWERUP, i);
+        grid.build();
+    }
+
+    // Pickups in pool order; removed afterwards, highest index first, so
+    // the indices stay valid
+    void pickPowerUps(Player& pl) {
+        if (!pl.alive) return;
+        pickHits.clear();
+        grid.query(pl.hitbox(), GRID_POWERUP, [&](const CollisionGrid::Entry& en) { pickHits.push_back(en.key); });
+        if (pickHits.empty()) return;
+        std::sort(pickHits.begin(), pickHits.end());
+        for (uint32_t k : pickHits) applyPowerUp(pl, powerUps[k].type);
+        for (int n = (int)pickHits.size() - 1; n >= 0; --n) powerUps.remove(pickHits[n]);
+        buildCollisionGrid();   // power-up indices moved
+    }
+
+    void updatePlaying(float dt, const InputFrame& in, const InputFrame& in2) {
+        updateShip(player, dt, in);
+        if (coop) updateShip(player2, dt, in2);
 
         // Move player bullets
-        for (auto& b : pBullets) {
-            if (!b.active) continue;
+        pBullets.removeIf([dt](Bullet& b) {
             b.y += b.vy * dt;
-            if (b.y < -BULLET_H - 8.f) b.active = false;
-        }
+            return b.y < -BULLET_H - 8.f;
+        });
 
         // Formation motion
         updateFormationMotion(dt);
 
         // Enemies in formation: sync position
-        for (auto& e : enemies) {
-            if (!e.alive) continue;
-            if (e.state == EnemyState::IN_FORMATION) {
-                e.x = formationX(e.col);
-                e.y = formationY(e.row, e.col);
-            }
+        for (int i = 0; i < enemies.formEnd; ++i) {
+            enemies.x[i] = formationX(enemies.col[i]);
+            enemies.y[i] = formationY(enemies.row[i], enemies.col[i]);
         }
 
         // Dive timer
         diveTimer -= dt;
         if (diveTimer <= 0.f && !boss.active) {
             startDive();
-            diveTimer = (float)GetRandomValue(200, 400) / 100.f / speedFactor();
+            diveTimer = (float)rng.gameplay.range(200, 400) / 100.f / speedFactor();
         }
 
-        // Update diving / returning enemies
-        for (auto& e : enemies) {
-            if (!e.alive) continue;
-            if (e.state == EnemyState::DIVING) {
-                updateDiving(e, dt);
-            } else if (e.state == EnemyState::RETURNING) {
-                updateReturning(e, dt);
-            }
-        }
+        // Move every diver and returner along its curve, then settle the
+        // ones that arrived. Each step returns false when
+        // the enemy left its range; the entry swapped into i is then one not
+        // yet updated (returners leave leftwards, so that range is walked
+        // backwards). Returners go first so a diver that starts its return
+        // this tick is not advanced twice.
+        advancePaths(dt);
+        for (int i = enemies.alive - 1; i >= enemies.diveEnd; )
+            if (updateReturning(i)) --i;
+        for (int i = enemies.formEnd; i < enemies.diveEnd; )
+            if (updateDiving(i, dt)) ++i;
 
         // Enemy bullets
-        for (auto& b : eBullets) {
-            if (!b.active) continue;
+        eBullets.removeIf([dt](Bullet& b) {
             b.y += b.vy * dt;
             b.x += b.vx * dt;
-            if (b.y > SH + 20.f) b.active = false;
-        }
+            return b.y > SH + 20.f;
+        });
 
         if (boss.active) {
             updateBoss(dt);
         }
 
-        for (auto& p : powerUps) {
-            if (!p.active) continue;
+        powerUps.removeIf([dt](PowerUp& p) {
             p.y += p.vy * dt;
-            if (p.y > SH + 16.f) p.active = false;
-            if (CheckCollisionRecs(p.rect(), player.hitbox())) {
-                p.active = false;
-                applyPowerUp(p.type);
-            }
-        }
-
-        // Collision: player bullets vs enemies
-        for (auto& pb : pBullets) {
-            if (!pb.active) continue;
-            Rectangle br = pb.rect();
+            return p.y > SH + 16.f;
+        });
+
+        // Everything has moved: collisions from here on go through the grid
+        buildCollisionGrid();
+
+        for (int i = 0; i < shipCount(); ++i) pickPowerUps(ship(i));
+
+        // Collision: player bullets vs boss, else the enemy met first along
+        // the bullet's path this tick (ties: lowest id)
+        pBullets.removeIf([&](const Bullet& pb) {
+            Sweep shot = bulletSweep(pb);
+            bool  bossHit = false;
+            int   hitId   = -1;
+            float hitT    = 2.f;
+            grid.query(sweepBounds(shot), GRID_ENEMY | GRID_BOSS, [&](const CollisionGrid::Entry& en) {
+                if (en.kind == GRID_BOSS) {
+                    bossHit = bossHit || (boss.active && sweptOverlap(shot, bossSweep()) >= 0.f);
+                    return;
+                }
+                int i = enemies.pos[en.key];
+                if (!enemies.isAlive(i)) return;
+                float t = sweptOverlap(shot, enemySweep(i));
+                if (t >= 0.f && (t < hitT || (t == hitT && (int)en.key < hitId))) { hitT = t; hitId = (int)en.key; }
+            });
 
-            if (boss.active && CheckCollisionRecs(br, boss.hitbox())) {
-                pb.active = false;
+            if (bossHit) {
                 boss.hp--;
-                spawnExplosion(pb.x, pb.y);
+                fx.spawnExplosion(rng.cosmetic, pb.x, pb.y);
                 if (boss.hp <= 0) {
                     boss.active = false;
                     score += 1000 + round * 80;
                     highScore = std::max(highScore, score);
-                    spawnExplosion(boss.x, boss.y, true);
+                    fx.spawnExplosion(rng.cosmetic, boss.x, boss.y, true);
                     spawnPowerUp(boss.x, boss.y);
                 }
-                continue;
-            }
-
-            for (auto& e : enemies) {
-                if (!e.alive) continue;
-                if (CheckCollisionRecs(br, e.hitbox())) {
-                    e.alive = false;
-                    pb.active = false;
-                    int pts = pointsForEnemy(e.type, e.state == EnemyState::DIVING);
-                    score += pts;
-                    highScore = std::max(highScore, score);
-                    spawnExplosion(e.x, e.y, false, e.type);
-                    spawnPowerUp(e.x, e.y);
-                    break;
-                }
-            }
-        }
-
-        pBullets.erase(std::remove_if(pBullets.begin(), pBullets.end(),
-            [](const Bullet& b){ return !b.active; }), pBullets.end());
-        eBullets.erase(std::remove_if(eBullets.begin(), eBullets.end(),
-            [](const Bullet& b){ return !b.active; }), eBullets.end());
-        powerUps.erase(std::remove_if(powerUps.begin(), powerUps.end(),
-            [](const PowerUp& p){ return !p.active; }), powerUps.end());
-
-        // Collision: enemy bullets vs player
-        if (!player.invincible) {
-            auto playerBoxes = Player::hitboxes(player.x, player.y);
-            for (auto& b : eBullets) {
-                if (!b.active) continue;
-                Rectangle br = b.rect();
-                if (CheckCollisionRecs(br, playerBoxes[0]) ||
-                    CheckCollisionRecs(br, playerBoxes[1])) {
-                    b.active = false;
-                    killPlayer();
-                    return;
-                }
+                return true;
             }
 
-            // Collision: diving/returning enemy body vs player
-            for (auto& e : enemies) {
-                if (!e.alive || (e.state != EnemyState::DIVING && e.state != EnemyState::RETURNING)) continue;
-                Rectangle er = e.hitbox();
-                if (CheckCollisionRecs(er, playerBoxes[0]) ||
-                    CheckCollisionRecs(er, playerBoxes[1])) {
-                    e.alive = false;
-                    spawnExplosion(e.x, e.y, false, e.type);
-                    killPlayer();
-                    return;
-                }
+            if (hitId >= 0) {
+                int i = enemies.pos[hitId];
+                float ex = enemies.x[i], ey = enemies.y[i];
+                EnemyType type = enemies.type[i];
+                int pts = pointsForEnemy(type, enemies.state(i) == EnemyState::DIVING);
+                enemies.kill(i);
+                score += pts;
+                highScore = std::max(highScore, score);
+                fx.spawnExplosion(rng.cosmetic, ex, ey, false, type);
+                spawnPowerUp(ex, ey);
+                return true;
             }
+            return false;
+        });
 
-            if (boss.active && (CheckCollisionRecs(boss.hitbox(), playerBoxes[0]) ||
-                                CheckCollisionRecs(boss.hitbox(), playerBoxes[1]))) {
-                killPlayer();
-                return;
-            }
+        // Collision: enemy bullets, divers and boss vs player
+        for (int i = 0; i < shipCount(); ++i) {
+            Player& pl = ship(i);
+            if (pl.alive && !pl.invincible && hitShip(pl)) return;
         }
 
         // Check stage clear
@@ -1291,345 +3131,2665 @@ struct Game {
             float rel = (count == 1) ? 0.f
                 : -spread + (2.f * spread / (count - 1)) * i;
             Bullet b;
-            b.active = true;
             b.enemy = true;
             b.x = boss.x + rel * boss.size;
             b.y = boss.y + boss.size * 0.2f;
 
-            float dx = player.x - b.x;
-            float dy = std::max(24.f, player.y - b.y);
+            const Player& target = targetFor(b.x);
+            float dx = target.x - b.x;
+            float dy = std::max(24.f, target.y - b.y);
             float dist = std::sqrt(dx * dx + dy * dy);
             float spd = (EBULLET_SPEED_BASE + round * 14.f) * 1.1f;
             // A mayor bossLevel, más apuntadas al jugador
             float aimFactor = std::min(0.55f + bossLevel * 0.1f, 0.9f);
             b.vx = (dx / dist) * spd * aimFactor;
             b.vy = (dy / dist) * spd;
-            eBullets.push_back(b);
+            b.prevX = b.x;
+            b.prevY = b.y;
+            eBullets.push(b);
+        }
+    }
+
+    void updateFormationMotion(float dt) {
+        float sf = (state == GameState::PLAYING) ? speedFactor() : 1.f;
+        float dir = (formVX >= 0.f) ? 1.f : -1.f;
+        float speed = std::abs(formVX) * sf;
+
+        // Edges (soft turn near borders to avoid harsh direction changes)
+        float maxX = formStartX - 10.f;
+        float distToEdge = (dir > 0.f) ? (maxX - formOffX) : (formOffX + maxX);
+        const float softZone = 26.f;
+        float edgeFactor = 1.f;
+        if (distToEdge < softZone) {
+            edgeFactor = std::clamp(distToEdge / softZone, 0.35f, 1.f);
+        }
+
+        formOffX += dir * speed * edgeFactor * dt;
+
+        if (formOffX > maxX) {
+            float overshoot = formOffX - maxX;
+            formOffX = maxX - overshoot;
+            formVX = -std::abs(formVX);
+        }
+        if (formOffX < -maxX) {
+            float overshoot = -maxX - formOffX;
+            formOffX = -maxX + overshoot;
+            formVX = std::abs(formVX);
+        }
+
+        // Vertical bobbing (Galaxian-like subtle up/down movement)
+        formSineT += dt;
+        formOffY  = sinf(formSineT * FORM_BOB_FREQ) * FORM_BOB_AMP;
+        updateFormationSlots();
+    }
+
+    // One pass over [formEnd, alive): distance -> t through the launch
+    // table, then position and heading. A returner's curve ends at its live
+    // formation slot; moving p3 by delta moves the curve by t^3 * delta (and
+    // its tangent by 3t^2 * delta), so the table built at launch still holds
+    // for the few pixels the formation sways.
+    void advancePaths(float dt) {
+        for (int i = enemies.formEnd; i < enemies.alive; ++i) {
+            EnemyPath& e = enemies.pathAt(i);
+            bool diving = i < enemies.diveEnd;
+            float speed = diving ? e.diveSpeed : e.diveSpeed * 0.8f;
+            e.dist = std::min(e.dist + speed * dt, e.lut.total());
+            float t = e.lut.param(e.dist);
+
+            Vector2 pos, dir;
+            if (diving) {
+                pos = bezier(e.p0, e.p1, e.p2, e.p3, t);
+                dir = bezierTangent(e.p0, e.p1, e.p2, e.p3, t);
+            } else {
+                int row = enemies.row[i], col = enemies.col[i];
+                float dx = formationX(col) - e.retP3.x, dy = formationY(row, col) - e.retP3.y;
+                float t2 = t * t, t3 = t2 * t;
+                pos = bezier(e.retP0, e.retP1, e.retP2, e.retP3, t);
+                dir = bezierTangent(e.retP0, e.retP1, e.retP2, e.retP3, t);
+                pos.x += t3 * dx;      pos.y += t3 * dy;
+                dir.x += 3 * t2 * dx;  dir.y += 3 * t2 * dy;
+            }
+            enemies.x[i] = pos.x;
+            enemies.y[i] = pos.y;
+            // 0 deg points "down" in this sprite set
+            enemies.heading[i] = std::atan2(dir.y, dir.x) * RAD2DEG - 90.f;
+        }
+    }
+
+    // false once the enemy has left the diving range
+    bool updateDiving(int i, float dt) {
+        EnemyPath& e = enemies.pathAt(i);
+        if (e.dist >= e.lut.total()) {
+            // Exited bottom – start return
+            returnToFormation(i);
+            return false;
+        }
+        float ex = enemies.x[i];
+        float ey = enemies.y[i];
+
+        // Shoot
+        if (e.bulletsLeft > 0) {
+            e.shootTimer -= dt;
+            if (e.shootTimer <= 0.f) {
+                e.shootTimer = e.shootInterval;
+                e.bulletsLeft--;
+                Bullet b;
+                b.enemy  = true;
+                b.x      = ex;
+                b.y      = ey + 8.f;
+                b.vx     = 0.f;
+                float eBulletSpd = EBULLET_SPEED_BASE + round * 12.f;
+                b.vy     = eBulletSpd;
+                // Aim mejora progresivamente con las rondas (0.25 ronda 1 → 0.55 ronda 7+)
+                float aimFactor = std::min(0.25f + (round - 1) * 0.05f, 0.55f);
+                float dx = targetFor(ex).x - ex;
+                float dist = std::abs(dx) + 200.f;
+                b.vx = (dx / dist) * eBulletSpd * aimFactor;
+                b.prevX = b.x;
+                b.prevY = b.y;
+                eBullets.push(b);
+            }
+        }
+        return true;
+    }
+
+    // false once the enemy is back in formation
+    bool updateReturning(int i) {
+        const EnemyPath& e = enemies.pathAt(i);
+        if (e.dist < e.lut.total()) return true;
+        // advancePaths() left it exactly on its slot
+        enemies.moveTo(i, EnemyState::IN_FORMATION);
+        return false;
+    }
+
+    void killPlayer(Player& player, DeathCause cause) {
+        if (player.invincible) return;
+        deaths[(int)cause]++;
+        fx.spawnExplosion(rng.cosmetic, player.x, player.y, true, EnemyType::ZAKO_BLUE, true);
+        player.lives--;
+        player.alive = false;
+        player.shotLevel = 1;
+        player.shotCooldown = 0.22f;
+        player.shotTimer = 0.f;
+        player.hasPowerUp = false;
+        player.powerUpTimer = 0.f;
+        pBullets.clear();
+        powerUps.clear();
+        eBullets.clear();
+        // Return all diving enemies to formation, parked on their slots with
+        // prev = current, so neither interpolation nor the swept collision
+        // sees a jump from the dive position when play resumes
+        int recalled = enemies.formEnd;
+        enemies.recallAll();
+        for (int i = recalled; i < enemies.formEnd; ++i) {
+            enemies.x[i] = enemies.prevX[i] = formationX(enemies.col[i]);
+            enemies.y[i] = enemies.prevY[i] = formationY(enemies.row[i], enemies.col[i]);
+        }
+        state      = GameState::PLAYER_DEAD;
+        stateTimer = 2.f;
+    }
+
+    int pointsForEnemy(EnemyType t, bool diving) {
+        int base = 0;
+        switch (t) {
+            case EnemyType::FLAGSHIP:   base = diving ? 400 : 150; break;
+            case EnemyType::ESCORT:     base = diving ? 160 :  40; break;
+            case EnemyType::ZAKO_BLUE:  base = diving ? 100 :  30; break;
+            case EnemyType::ZAKO_BLUE2: base = diving ?  80 :  20; break;
+            case EnemyType::ZAKO_GREEN: base = diving ?  60 :  10; break;
+        }
+        return base;
+    }
+
+    // ── draw ──────────────────────────────────────────────────
+    void draw(float alpha = 1.f) {
+        renderAlpha = std::clamp(alpha, 0.f, 1.f);
+        ClearBackground(BLACK);
+        // Todo se graba en gDraw y sale ordenado en submit()
+        stars.draw();
+
+        switch (state) {
+            case GameState::ATTRACT:       drawAttract();     break;
+            case GameState::PLAYING:       drawPlaying();     break;
+            case GameState::PLAYER_DEAD:   drawDead();        break;
+            case GameState::GAME_OVER:     drawGameOver();    break;
+            case GameState::STAGE_CLEAR:   drawClear();       break;
+        }
+        fx.draw();
+        gDraw.submit();
+    }
+
+    float lerp(float prev, float cur) const { return prev + (cur - prev) * renderAlpha; }
+
+    float powerUpRatio() const {
+        return player.powerUpMaxDuration > 0.f ? player.powerUpTimer / player.powerUpMaxDuration : 0.f;
+    }
+
+    // Todo lo que pinta paintHUD; el power-up activo va aparte
+    // (drawPowerUpTimer) porque su barra cambia casi cada frame
+    HudLayer::Key hudKey() const {
+        return {score, highScore, player.lives, coop ? player2.lives : -1, round,
+                player.hasPowerUp};
+    }
+
+    // Antes de dibujar la escena (fuera de su BeginTextureMode)
+    void refreshHud() {
+        gHud.refresh(hudKey(), [this] { paintHUD(); });
+    }
+
+    void drawHUD() {
+        if (!gHud.draw(hudKey())) paintHUD();
+        drawPowerUpTimer();
+    }
+
+    // Barra de tiempo restante, cada frame encima de la capa del HUD
+    void drawPowerUpTimer() {
+        if (!player.hasPowerUp) return;
+        float ratio = powerUpRatio();
+        Color barCol = (ratio > 0.35f) ? Color{120, 255, 120, 255} : Color{255, 160, 40, 255};
+        gDraw.begin(LAYER_HUD);
+        gDraw.text(TextFormat("SHOT x%d", player.shotLevel), 10, 34, 14, barCol);
+        gDraw.fillRect(10, 52, 60, 5, {60, 60, 60, 200});
+        gDraw.fillRect(10, 52, (int)(60.f * ratio), 5, barCol);
+    }
+
+    void paintHUD() {
+        gDraw.begin(LAYER_HUD);
+        // Score top left
+        drawDigits(score, 6, 10, 10, 20, WHITE);
+
+        // High score centered
+        gDraw.text("HIGH SCORE", SW/2 - 50, 8, 14, WHITE);
+        drawDigits(highScore, 6, SW/2 - 30, 22, 14, WHITE);
+        if (!player.hasPowerUp) gDraw.text("SHOT x1", 10, 34, 14, {160, 160, 160, 200});
+
+        // Lives (bottom left as ship icons; player 2 from the centre)
+        for (int i = 0; i < player.lives; ++i) {
+            drawSprite(gSprites.playerLife, 20.f + i * 28.f, SH - 18.f, LIFE_ICON_SIZE);
+        }
+        if (coop) {
+            for (int i = 0; i < player2.lives; ++i)
+                drawSprite(gSprites.playerLife, SW / 2.f + 20.f + i * 28.f, SH - 18.f, LIFE_ICON_SIZE);
+        }
+
+        // Round flags (bottom right)
+        for (int i = 0; i < round && i < 8; ++i) {
+            Color fc = {(unsigned char)(100 + i*20), 80, 200, 255};
+            gDraw.fillRect(SW - 20 - i*16, SH - 26, 12, 16, fc);
+        }
+    }
+
+    void drawEnemies() {
+        if (boss.active) {
+            {
+                AnimFrame f = bossAnimFrame(anim, boss.type);
+                gDraw.begin(LAYER_ENEMIES);
+                drawSprite(gSprites.enemyFrame(f.set, f.index), lerp(boss.prevX, boss.x), boss.y, boss.size);
+            }
+
+            gDraw.begin(LAYER_HUD);
+            float bw = 180.f;
+            float bh = 8.f;
+            float bx = SW * 0.5f - bw * 0.5f;
+            float by = 52.f;
+            float pct = (boss.maxHp > 0) ? (float)boss.hp / (float)boss.maxHp : 0.f;
+            gDraw.fillRect((int)bx, (int)by, (int)bw, (int)bh, {70, 70, 70, 220});
+            gDraw.fillRect((int)bx, (int)by, (int)(bw * std::clamp(pct, 0.f, 1.f)), (int)bh, {255, 90, 90, 255});
+            gDraw.text("BOSS", (int)bx, (int)by - 14, 12, {255, 180, 180, 255});
+        }
+
+        gDraw.begin(LAYER_ENEMIES);
+        for (int i = 0; i < enemies.alive; ++i) {
+            EnemyType type = enemies.type[i];
+            float ex = lerp(enemies.prevX[i], enemies.x[i]);
+            float ey = lerp(enemies.prevY[i], enemies.y[i]);
+            float rot = enemyBaseRotation(type);
+            if (enemies.state(i) == EnemyState::DIVING) rot += enemies.heading[i];
+            drawEnemy(anim, type, ex, ey, rot, enemies.col[i]);
+        }
+    }
+
+    // Halo y núcleo horneados en el atlas (bakeBulletGlow): todas las balas
+    // en un solo grupo aditivo
+    void drawBullets() {
+        auto at = [this](const Bullet& b) { return Vector2{lerp(b.prevX, b.x), lerp(b.prevY, b.y)}; };
+        gDraw.begin(LAYER_BULLETS);
+        gDraw.setBlend(BLEND_ADDITIVE);
+        drawAtlasQuads(pBullets, gSprites.pBullet, gSprites.pBulletAnchor, at);
+        drawAtlasQuads(eBullets, gSprites.eBullet, gSprites.eBulletAnchor, at);
+    }
+
+    void drawPowerUps() {
+        // Cada power-up entero (círculo y letra) sobre los anteriores
+        gDraw.begin(LAYER_PICKUPS);
+        for (const auto& p : powerUps) {
+            gDraw.nextSeq();
+            Color c = {120, 220, 255, 255};
+            const char* label = "F";
+            if (p.type == PowerUpType::DOUBLE_SHOT) { c = {255, 220, 120, 255}; label = "2"; }
+            if (p.type == PowerUpType::TRIPLE_SHOT) { c = {255, 140, 120, 255}; label = "3"; }
+            gDraw.circle((int)p.x, (int)p.y, 8.f, c);
+            gDraw.text(label, (int)p.x - 4, (int)p.y - 6, 12, BLACK);
+        }
+    }
+
+    void drawPlaying() {
+        drawEnemies();
+        drawBullets();
+        drawPowerUps();
+
+        // Player (blinks when invincible)
+        for (int i = 0; i < shipCount(); ++i) {
+            const Player& p = ship(i);
+            bool showPlayer = p.alive &&
+                (!p.invincible || (int)(p.invTimer * 10) % 2 == 0);
+            if (showPlayer)
+                drawPlayerShip(lerp(p.prevX, p.x), p.y, p.vx, p.thrusterTime);
         }
+
+        drawHUD();
+    }
+
+    void drawDead() {
+        drawEnemies();
+        drawHUD();
+    }
+
+    void drawGameOver() {
+        drawEnemies();
+        drawHUD();
+        gDraw.begin(LAYER_HUD);
+        static const int tw = MeasureText("GAME OVER", 40);
+        gDraw.text("GAME OVER", SW/2 - tw/2, SH/2 - 20, 40, RED);
+    }
+
+    void drawAttract() {
+        gDraw.begin(LAYER_HUD);
+        // Big title
+        static const int tw = MeasureText("GALAX IA", 48);
+        gDraw.text("GALAX IA", SW/2 - tw/2, 40, 48, {255, 220, 50, 255});
+
+        drawEnemies();
+        gDraw.begin(LAYER_HUD);
+
+        // High score
+        gDraw.text("HIGH SCORE", SW/2 - 50, SH/2 - 30, 16, WHITE);
+        drawDigits(highScore, 6, SW/2 - 36, SH/2 - 10, 20, WHITE);
+
+        // Blink "INSERT COIN"
+        if (blinkOn) {
+            static const int iw = MeasureText("PRESS ENTER TO PLAY", 18);
+            gDraw.text("PRESS ENTER TO PLAY", SW/2 - iw/2, SH*3/4, 18, {200, 200, 200, 255});
+        }
+
+        // Controls hint
+        gDraw.text("MOVE: ARROWS / A-D    FIRE: SPACE", 30, SH - 36, 12, {150,150,150,255});
+    }
+
+    void drawClear() {
+        gDraw.begin(LAYER_HUD);
+        // Flash effect
+        float t = flashTimer;
+        if ((int)(t * 8) % 2 == 0) {
+            gDraw.fillRect(0, 0, SW, SH, {255,255,255, 60});
+        }
+        static const int tw = MeasureText("STAGE CLEAR!", 36);
+        gDraw.text("STAGE CLEAR!", SW/2 - tw/2, SH/2 - 18, 36, {100, 255, 100, 255});
+        drawHUD();
+    }
+};
+
+static uint32_t snapshotLayoutTag() {
+    Fnv64 h;
+    h.add(sizeof(StarField)); h.add(sizeof(Player));    h.add(sizeof(EnemyAnim));
+    h.add(sizeof(GameRng));   h.add(FX_MAX_PARTICLES);  h.add(FX_MAX_FLASHES);
+    h.add(FX_MAX_DEBRIS);     h.add(sizeof(EnemyPath));     h.add(sizeof(Bullet));
+    h.add(sizeof(PowerUp));   h.add(sizeof(Boss));      h.add(sizeof(GameState));
+    h.add(sizeof(GameTuning));
+    return (uint32_t)(h.h ^ (h.h >> 32));
+}
+
+// ─────────────────────────────────────────────────────────────
+//  FIXED-STEP CLOCK
+// ─────────────────────────────────────────────────────────────
+// Accumulates real frame time and hands out whole simulation ticks; the
+// remainder becomes the interpolation factor for drawing.
+struct SimClock {
+    double step = 1.0 / SIM_HZ_DEFAULT;
+    double acc  = 0.0;
+
+    void setRate(int hz) { step = 1.0 / std::max(1, hz); }
+
+    int advance(float frameTime) {
+        acc += std::min(frameTime, MAX_FRAME_TIME);
+        int ticks = (int)(acc / step);
+        acc -= ticks * step;
+        return ticks;
+    }
+
+    float alpha() const { return (float)(acc / step); }
+};
+
+// ─────────────────────────────────────────────────────────────
+//  REPLAYS
+// ─────────────────────────────────────────────────────────────
+static constexpr uint32_t REPLAY_MAGIC          = 0x50525847;   // "GXRP"
+static constexpr uint16_t REPLAY_VERSION        = 4;
+static constexpr uint32_t REPLAY_CHECK_INTERVAL = 120;          // ticks between checksums
+
+static uint8_t packInput(const InputFrame& in) {
+    return (uint8_t)((in.left ? 1 : 0) | (in.right ? 2 : 0) | (in.fire ? 4 : 0) | (in.start ? 8 : 0));
+}
+
+static InputFrame unpackInput(uint8_t bits) {
+    InputFrame in;
+    in.left  = (bits & 1) != 0;
+    in.right = (bits & 2) != 0;
+    in.fire  = (bits & 4) != 0;
+    in.start = (bits & 8) != 0;
+    return in;
+}
+
+// Tuning the game was booted with; replays apply it before boot()
+static void writeTuning(ByteWriter& w, const GameTuning& t) {
+    w.f32(t.diveInterval);
+    w.f32(t.diveIntervalMin);
+    w.f32(t.speedScale);
+    w.f32(t.bossHpScale);
+    w.u32((uint32_t)t.playerBulletCap);
+    w.u32((uint32_t)t.enemyBulletCap);
+    w.u32((uint32_t)t.powerUpCap);
+    w.u8((uint8_t)t.formCols);
+    w.u8((uint8_t)t.formRows);
+}
+
+static GameTuning readTuning(ByteReader& r) {
+    GameTuning t;
+    t.diveInterval    = r.f32();
+    t.diveIntervalMin = r.f32();
+    t.speedScale      = r.f32();
+    t.bossHpScale     = r.f32();
+    // Caps size the pools at boot; out-of-range values mean a corrupt file
+    auto cap = [&r]() {
+        uint32_t v = r.u32();
+        if (v < 1 || v > (uint32_t)POOL_MAX_CAPACITY) r.ok = false;
+        return (int)std::min(v, (uint32_t)POOL_MAX_CAPACITY);
+    };
+    t.playerBulletCap = cap();
+    t.enemyBulletCap  = cap();
+    t.powerUpCap      = cap();
+    // Stored as clamped by Game::layoutFormation
+    t.formCols = r.u8();
+    t.formRows = r.u8();
+    if (t.formCols < 2 || t.formCols > FORM_MAX_COLS || t.formRows < 1 || t.formRows > FORM_MAX_ROWS) r.ok = false;
+    return t;
+}
+
+// Input log of one session from Game::boot(seed) with the recorded tuning,
+// or from a snapshot when the session did not start at boot. Inputs are stored as runs of identical
+// ticks (a held key costs two bytes per change, not per tick), plus the
+// chained tick hash (Game::tickHash) every checkInterval ticks.
+//
+// File layout (little-endian):
+//   u32 magic, u16 version, u16 simHz, u64 seed, tuning (writeTuning),
+//   u32 ticks, u32 checkInterval,
+//   varint stateSize, stateSize x u8 (initial snapshot, may be empty),
+//   varint runCount, runCount x (u8 input bits, varint length),
+//   varint checksumCount, checksumCount x u64, u64 final checksum
+struct Replay {
+    uint64_t seed          = 0;
+    uint16_t simHz         = SIM_HZ_DEFAULT;
+    GameTuning tuning;
+    uint32_t ticks         = 0;
+    uint32_t checkInterval = REPLAY_CHECK_INTERVAL;
+    std::vector<uint8_t>  initialState;
+    std::vector<uint8_t>  runInput;
+    std::vector<uint32_t> runLength;
+    std::vector<uint64_t> checksums;     // after tick (k + 1) * checkInterval
+    uint64_t finalChecksum = 0;
+
+    // from: starting state when it is not plain boot(seed) with tuning t,
+    // else nullptr
+    void start(uint64_t s, int hz, const GameTuning& t, const Game* from = nullptr) {
+        *this = Replay{};
+        seed   = s;
+        simHz  = (uint16_t)hz;
+        tuning = t;
+        if (from) from->saveState(initialState);
+    }
+
+    // Call once per tick, after Game::update(dt, in)
+    void record(const InputFrame& in, const Game& g) {
+        uint8_t bits = packInput(in);
+        if (!runInput.empty() && runInput.back() == bits && runLength.back() < UINT32_MAX)
+            ++runLength.back();
+        else {
+            runInput.push_back(bits);
+            runLength.push_back(1);
+        }
+        ++ticks;
+        finalChecksum = g.tickHash;
+        if (ticks % checkInterval == 0) checksums.push_back(finalChecksum);
+    }
+
+    void encode(std::vector<uint8_t>& data) const {
+        data.clear();
+        ByteWriter w{data};
+        w.u32(REPLAY_MAGIC);
+        w.u16(REPLAY_VERSION);
+        w.u16(simHz);
+        w.u64(seed);
+        writeTuning(w, tuning);
+        w.u32(ticks);
+        w.u32(checkInterval);
+        w.varint(initialState.size());
+        for (uint8_t b : initialState) w.u8(b);
+        w.varint(runInput.size());
+        for (size_t i = 0; i < runInput.size(); ++i) {
+            w.u8(runInput[i]);
+            w.varint(runLength[i]);
+        }
+        w.varint(checksums.size());
+        for (uint64_t c : checksums) w.u64(c);
+        w.u64(finalChecksum);
+    }
+
+    bool save(const char* path) const {
+        std::vector<uint8_t> data;
+        encode(data);
+        return writeFile(path, data);
+    }
+
+    bool decode(const std::vector<uint8_t>& data) {
+        ByteReader r{data.data(), data.data() + data.size()};
+        if (r.u32() != REPLAY_MAGIC || r.u16() != REPLAY_VERSION) return false;
+        *this = Replay{};
+        simHz         = r.u16();
+        seed          = r.u64();
+        tuning        = readTuning(r);
+        ticks         = r.u32();
+        checkInterval = r.u32();
+        uint64_t stateSize = r.varint();
+        if (!r.ok || !r.need(stateSize)) return false;
+        initialState.assign(r.p, r.p + stateSize);
+        r.p += stateSize;
+        uint64_t runs = r.varint();
+        if (!r.ok || runs > data.size()) return false;
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < runs && r.ok; ++i) {
+            runInput.push_back(r.u8());
+            runLength.push_back((uint32_t)r.varint());
+            total += runLength.back();
+        }
+        uint64_t nsum = r.varint();
+        if (!r.ok || nsum > data.size()) return false;
+        for (uint64_t i = 0; i < nsum && r.ok; ++i) checksums.push_back(r.u64());
+        finalChecksum = r.u64();
+        return r.ok && total == ticks && simHz > 0 && checkInterval > 0;
+    }
+
+    bool load(const char* path) {
+        std::vector<uint8_t> data;
+        return readFile(path, data) && decode(data);
+    }
+};
+
+// One text line per tick: "tick state_hash chained_hash". Two traces of the
+// same seed and inputs can be diffed to find the first tick that diverges.
+struct HashTrace {
+    std::FILE* f = nullptr;
+
+    bool open(const char* path) {
+        f = std::fopen(path, "w");
+        return f != nullptr;
+    }
+    void write(const Game& g) {
+        if (f) std::fprintf(f, "%u %016llx %016llx\n", g.tick,
+            (unsigned long long)g.stateHash, (unsigned long long)g.tickHash);
+    }
+    ~HashTrace() { if (f) std::fclose(f); }
+};
+
+// ─────────────────────────────────────────────────────────────
+//  SOFTWARE RENDERER
+// ─────────────────────────────────────────────────────────────
+// CPU rasterizer that draws the same scene as Game::draw into an SW x SH
+// RGBA8 buffer with no GL context (pixel observations, headless shots).
+// Every blend goes through one integer formula, shared by the SSE2 and the
+// scalar kernels, so a frame is bit-identical whichever path a build takes.
+// Shapes are sampled at pixel centres; edges may differ slightly from GL.
+
+enum class SoftBlend { ALPHA, ADDITIVE };
+
+// Sprite en CPU: píxeles RGBA8 sin premultiplicar
+struct SoftSprite {
+    int w = 0, h = 0;
+    std::vector<Color> px;
+};
+
+struct SoftSprites : SpriteSet<SoftSprite> {
+    static SoftSprite loadSprite(const char* path, int outputSize, bool trim) {
+        SoftSprite s;
+        Image img = loadSpriteImage(path, outputSize, trim);
+        if (img.data == nullptr) return s;
+        ImageFormat(&img, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+        s.w = img.width;
+        s.h = img.height;
+        s.px.assign((const Color*)img.data, (const Color*)img.data + (size_t)s.w * s.h);
+        UnloadImage(img);
+        return s;
+    }
+};
+
+// Loaded on first use, once per process (static init is thread-safe)
+static const SoftSprites& softSprites() {
+    static const SoftSprites sprites = [] {
+        SoftSprites s;
+        s.loadWith(SoftSprites::loadSprite);
+        return s;
+    }();
+    return sprites;
+}
+
+// x / 255 rounded to nearest, exact for 0..255*255
+static inline int div255(int x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+// dst[i] = blend(dst[i], c) for n pixels
+static void blendSpan(Color* dst, int n, Color c, SoftBlend mode) {
+    if (n <= 0 || (c.a == 0)) return;
+    if (mode == SoftBlend::ALPHA && c.a == 255) {
+        std::fill_n(dst, n, Color{c.r, c.g, c.b, 255});
+        return;
+    }
+    int i = 0;
+#if GX_SOFT_SSE2
+    const __m128i opaque = _mm_set1_epi32((int)0xFF000000u);
+    if (mode == SoftBlend::ADDITIVE) {
+        Color add = {(unsigned char)div255(c.r * c.a), (unsigned char)div255(c.g * c.a),
+                     (unsigned char)div255(c.b * c.a), 0};
+        uint32_t addWord;
+        std::memcpy(&addWord, &add, 4);
+        const __m128i addv = _mm_set1_epi32((int)addWord);
+        for (; i + 4 <= n; i += 4) {
+            __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_adds_epu8(d, addv), opaque));
+        }
+    } else {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i c128 = _mm_set1_epi16(128);
+        const __m128i sa   = _mm_setr_epi16(c.r * c.a, c.g * c.a, c.b * c.a, 0,
+                                            c.r * c.a, c.g * c.a, c.b * c.a, 0);
+        const __m128i inv  = _mm_set1_epi16((short)(255 - c.a));
+        auto mix = [&](__m128i d) {
+            __m128i v = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(d, inv), sa), c128);
+            return _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+        };
+        for (; i + 4 <= n; i += 4) {
+            __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+            __m128i r = _mm_packus_epi16(mix(_mm_unpacklo_epi8(d, zero)), mix(_mm_unpackhi_epi8(d, zero)));
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(r, opaque));
+        }
+    }
+#endif
+    const int inv = 255 - c.a;
+    for (; i < n; ++i) {
+        Color& d = dst[i];
+        if (mode == SoftBlend::ADDITIVE) {
+            d.r = (unsigned char)std::min(255, d.r + div255(c.r * c.a));
+            d.g = (unsigned char)std::min(255, d.g + div255(c.g * c.a));
+            d.b = (unsigned char)std::min(255, d.b + div255(c.b * c.a));
+        } else {
+            d.r = (unsigned char)div255(c.r * c.a + d.r * inv);
+            d.g = (unsigned char)div255(c.g * c.a + d.g * inv);
+            d.b = (unsigned char)div255(c.b * c.a + d.b * inv);
+        }
+        d.a = 255;
+    }
+}
+
+// dst[i] = blend(dst[i], src[i]) with per-pixel source alpha
+static void blendRow(Color* dst, const Color* src, int n, SoftBlend mode) {
+    int i = 0;
+#if GX_SOFT_SSE2
+    const __m128i zero   = _mm_setzero_si128();
+    const __m128i c128   = _mm_set1_epi16(128);
+    const __m128i c255   = _mm_set1_epi16(255);
+    const __m128i opaque = _mm_set1_epi32((int)0xFF000000u);
+    auto div255v = [&](__m128i v) {
+        v = _mm_add_epi16(v, c128);
+        return _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+    };
+    auto mix = [&](__m128i s, __m128i d) {
+        __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xFF), 0xFF);  // alpha a los 4 canales
+        __m128i sa = _mm_mullo_epi16(s, a);
+        if (mode == SoftBlend::ADDITIVE) return _mm_add_epi16(d, div255v(sa));
+        return div255v(_mm_add_epi16(sa, _mm_mullo_epi16(d, _mm_sub_epi16(c255, a))));
+    };
+    for (; i + 4 <= n; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_srli_epi32(s, 24), zero)) == 0xFFFF) continue;
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i lo = mix(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+        __m128i hi = mix(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_packus_epi16(lo, hi), opaque));
+    }
+#endif
+    for (; i < n; ++i) {
+        Color s = src[i];
+        if (s.a == 0) continue;
+        Color& d = dst[i];
+        if (mode == SoftBlend::ADDITIVE) {
+            d.r = (unsigned char)std::min(255, d.r + div255(s.r * s.a));
+            d.g = (unsigned char)std::min(255, d.g + div255(s.g * s.a));
+            d.b = (unsigned char)std::min(255, d.b + div255(s.b * s.a));
+        } else {
+            int inv = 255 - s.a;
+            d.r = (unsigned char)div255(s.r * s.a + d.r * inv);
+            d.g = (unsigned char)div255(s.g * s.a + d.g * inv);
+            d.b = (unsigned char)div255(s.b * s.a + d.b * inv);
+        }
+        d.a = 255;
+    }
+}
+
+// Fuente 5x7 integrada (la fuente por defecto de raylib vive en una textura GL).
+// Una fila por byte, bit 4 = columna izquierda.
+struct SoftGlyph { char ch; uint8_t rows[7]; };
+static constexpr SoftGlyph SOFT_FONT[] = {
+    {'0', {0x0E,0x11,0x13,0x15,0x19,0x11,0x0E}}, {'1', {0x04,0x0C,0x04,0x04,0x04,0x04,0x0E}},
+    {'2', {0x0E,0x11,0x01,0x02,0x04,0x08,0x1F}}, {'3', {0x1F,0x02,0x04,0x02,0x01,0x11,0x0E}},
+    {'4', {0x02,0x06,0x0A,0x12,0x1F,0x02,0x02}}, {'5', {0x1F,0x10,0x1E,0x01,0x01,0x11,0x0E}},
+    {'6', {0x06,0x08,0x10,0x1E,0x11,0x11,0x0E}}, {'7', {0x1F,0x01,0x02,0x04,0x08,0x08,0x08}},
+    {'8', {0x0E,0x11,0x11,0x0E,0x11,0x11,0x0E}}, {'9', {0x0E,0x11,0x11,0x0F,0x01,0x02,0x0C}},
+    {'A', {0x0E,0x11,0x11,0x1F,0x11,0x11,0x11}}, {'B', {0x1E,0x11,0x11,0x1E,0x11,0x11,0x1E}},
+    {'C', {0x0E,0x11,0x10,0x10,0x10,0x11,0x0E}}, {'D', {0x1C,0x12,0x11,0x11,0x11,0x12,0x1C}},
+    {'E', {0x1F,0x10,0x10,0x1E,0x10,0x10,0x1F}}, {'F', {0x1F,0x10,0x10,0x1E,0x10,0x10,0x10}},
+    {'G', {0x0E,0x11,0x10,0x17,0x11,0x11,0x0F}}, {'H', {0x11,0x11,0x11,0x1F,0x11,0x11,0x11}},
+    {'I', {0x0E,0x04,0x04,0x04,0x04,0x04,0x0E}}, {'J', {0x07,0x02,0x02,0x02,0x02,0x12,0x0C}},
+    {'K', {0x11,0x12,0x14,0x18,0x14,0x12,0x11}}, {'L', {0x10,0x10,0x10,0x10,0x10,0x10,0x1F}},
+    {'M', {0x11,0x1B,0x15,0x15,0x11,0x11,0x11}}, {'N', {0x11,0x11,0x19,0x15,0x13,0x11,0x11}},
+    {'O', {0x0E,0x11,0x11,0x11,0x11,0x11,0x0E}}, {'P', {0x1E,0x11,0x11,0x1E,0x10,0x10,0x10}},
+    {'Q', {0x0E,0x11,0x11,0x11,0x15,0x12,0x0D}}, {'R', {0x1E,0x11,0x11,0x1E,0x14,0x12,0x11}},
+    {'S', {0x0F,0x10,0x10,0x0E,0x01,0x01,0x1E}}, {'T', {0x1F,0x04,0x04,0x04,0x04,0x04,0x04}},
+    {'U', {0x11,0x11,0x11,0x11,0x11,0x11,0x0E}}, {'V', {0x11,0x11,0x11,0x11,0x11,0x0A,0x04}},
+    {'W', {0x11,0x11,0x11,0x15,0x15,0x15,0x0A}}, {'X', {0x11,0x11,0x0A,0x04,0x0A,0x11,0x11}},
+    {'Y', {0x11,0x11,0x11,0x0A,0x04,0x04,0x04}}, {'Z', {0x1F,0x01,0x02,0x04,0x08,0x10,0x1F}},
+    {'x', {0x00,0x00,0x11,0x0A,0x04,0x0A,0x11}}, {'!', {0x04,0x04,0x04,0x04,0x04,0x00,0x04}},
+    {':', {0x00,0x0C,0x0C,0x00,0x0C,0x0C,0x00}}, {'/', {0x00,0x01,0x02,0x04,0x08,0x10,0x00}},
+    {'-', {0x00,0x00,0x00,0x1F,0x00,0x00,0x00}},
+};
+
+static const SoftGlyph* softGlyph(char ch) {
+    if (ch >= 'a' && ch <= 'z' && ch != 'x') ch = (char)(ch - 'a' + 'A');
+    for (const auto& g : SOFT_FONT) if (g.ch == ch) return &g;
+    return nullptr;   // espacio y caracteres sin glifo solo avanzan
+}
+
+struct SoftCanvas {
+    std::vector<Color> px;
+    std::vector<Color> row;            // fila temporal para sprites y degradados
+    int clipX0 = 0, clipY0 = 0, clipX1 = SW, clipY1 = SH;   // scissor [x0,x1) x [y0,y1)
+    SoftBlend blend = SoftBlend::ALPHA;
+
+    SoftCanvas() : px((size_t)SW * SH), row(SW) {}
+
+    Color* line(int y) { return px.data() + (size_t)y * SW; }
+
+    void clear(Color c) { std::fill(px.begin(), px.end(), Color{c.r, c.g, c.b, 255}); }
+
+    void setClip(int x, int y, int w, int h) {
+        clipX0 = std::max(0, x);      clipY0 = std::max(0, y);
+        clipX1 = std::min(SW, x + w); clipY1 = std::min(SH, y + h);
+    }
+    void resetClip() { clipX0 = 0; clipY0 = 0; clipX1 = SW; clipY1 = SH; }
+
+    // Píxeles [x0, x1) de la fila y
+    void span(int y, int x0, int x1, Color c) {
+        if (y < clipY0 || y >= clipY1) return;
+        x0 = std::max(x0, clipX0);
+        x1 = std::min(x1, clipX1);
+        if (x0 < x1) blendSpan(line(y) + x0, x1 - x0, c, blend);
+    }
+
+    void rect(int x, int y, int w, int h, Color c) {
+        for (int yy = y; yy < y + h; ++yy) span(yy, x, x + w, c);
+    }
+
+    void rectGradientV(int x, int y, int w, int h, Color top, Color bottom) {
+        for (int yy = 0; yy < h; ++yy) {
+            float t = h > 1 ? (yy + 0.5f) / h : 0.f;
+            span(y + yy, x, x + w, lerpColor(top, bottom, t));
+        }
+    }
+
+    static Color lerpColor(Color a, Color b, float t) {
+        auto ch = [t](unsigned char u, unsigned char v) {
+            return (unsigned char)(u + (v - u) * t + 0.5f);
+        };
+        return {ch(a.r, b.r), ch(a.g, b.g), ch(a.b, b.b), ch(a.a, b.a)};
+    }
+
+    // Rellena los píxeles cuyo centro cumple inside(x, y) dentro de la caja,
+    // emitiendo tramos consecutivos para el kernel de span.
+    template<class Inside>
+    void fillShape(float bx0, float by0, float bx1, float by1, Color c, Inside inside) {
+        int y0 = std::max(clipY0, (int)std::floor(by0)), y1 = std::min(clipY1 - 1, (int)std::ceil(by1));
+        int x0 = std::max(clipX0, (int)std::floor(bx0)), x1 = std::min(clipX1 - 1, (int)std::ceil(bx1));
+        for (int y = y0; y <= y1; ++y) {
+            int run = -1;
+            for (int x = x0; x <= x1 + 1; ++x) {
+                bool in = x <= x1 && inside(x + 0.5f, y + 0.5f);
+                if (in && run < 0) run = x;
+                if (!in && run >= 0) { span(y, run, x, c); run = -1; }
+            }
+        }
+    }
+
+    void circle(float cx, float cy, float r, Color c) {
+        fillShape(cx - r, cy - r, cx + r, cy + r, c, [=](float x, float y) {
+            return (x - cx) * (x - cx) + (y - cy) * (y - cy) <= r * r;
+        });
+    }
+
+    void ring(float cx, float cy, float r0, float r1, Color c) {
+        fillShape(cx - r1, cy - r1, cx + r1, cy + r1, c, [=](float x, float y) {
+            float d2 = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+            return d2 >= r0 * r0 && d2 <= r1 * r1;
+        });
+    }
+
+    // Rectángulo w x h girado rotDeg alrededor de (x, y) = origen dentro del rectángulo
+    void rectPro(Rectangle r, Vector2 origin, float rotDeg, Color c) {
+        float cs = cosf(rotDeg * DEG2RAD), sn = sinf(rotDeg * DEG2RAD);
+        float ext = r.width + r.height;
+        fillShape(r.x - ext, r.y - ext, r.x + ext, r.y + ext, c, [=](float x, float y) {
+            float dx = x - r.x, dy = y - r.y;
+            float u = dx * cs + dy * sn + origin.x;
+            float v = -dx * sn + dy * cs + origin.y;
+            return u >= 0.f && u < r.width && v >= 0.f && v < r.height;
+        });
+    }
+
+    // Segmento grueso sin remates (como DrawLineEx)
+    void lineEx(Vector2 a, Vector2 b, float thick, Color c) {
+        float dx = b.x - a.x, dy = b.y - a.y;
+        float len2 = dx * dx + dy * dy;
+        if (len2 <= 0.f) return;
+        float h = thick * 0.5f;
+        fillShape(std::min(a.x, b.x) - h, std::min(a.y, b.y) - h,
+                  std::max(a.x, b.x) + h, std::max(a.y, b.y) + h, c, [=](float x, float y) {
+            float t = ((x - a.x) * dx + (y - a.y) * dy) / len2;
+            if (t < 0.f || t > 1.f) return false;
+            float ex = a.x + dx * t - x, ey = a.y + dy * t - y;
+            return ex * ex + ey * ey <= h * h;
+        });
+    }
+
+    // Degradado radial: inner en el centro, outer en el borde
+    void circleGradient(float cx, float cy, float r, Color inner, Color outer) {
+        if (r <= 0.f) return;
+        int y0 = std::max(clipY0, (int)std::floor(cy - r)), y1 = std::min(clipY1 - 1, (int)std::ceil(cy + r));
+        int x0 = std::max(clipX0, (int)std::floor(cx - r)), x1 = std::min(clipX1 - 1, (int)std::ceil(cx + r));
+        if (x0 > x1) return;
+        for (int y = y0; y <= y1; ++y) {
+            float dy = y + 0.5f - cy;
+            for (int x = x0; x <= x1; ++x) {
+                float dx = x + 0.5f - cx;
+                float d = sqrtf(dx * dx + dy * dy) / r;
+                row[x - x0] = d <= 1.f ? lerpColor(inner, outer, d) : BLANK;
+            }
+            blendRow(line(y) + x0, row.data(), x1 - x0 + 1, blend);
+        }
+    }
+
+    // Sprite size x size centrado en (cx, cy), girado rotDeg, muestreo nearest
+    void sprite(const SoftSprite& s, float cx, float cy, float size, float rotDeg, unsigned char alpha) {
+        if (s.w == 0 || size <= 0.f || alpha == 0) return;
+        float half = size * 0.5f;
+        float ext  = rotDeg != 0.f ? half * 1.4143f : half;
+        int y0 = std::max(clipY0, (int)std::floor(cy - ext)), y1 = std::min(clipY1 - 1, (int)std::ceil(cy + ext));
+        int x0 = std::max(clipX0, (int)std::floor(cx - ext)), x1 = std::min(clipX1 - 1, (int)std::ceil(cx + ext));
+        if (x0 > x1) return;
+        float cs = cosf(rotDeg * DEG2RAD), sn = sinf(rotDeg * DEG2RAD);
+        float sx = s.w / size, sy = s.h / size;
+        for (int y = y0; y <= y1; ++y) {
+            float dy = y + 0.5f - cy;
+            for (int x = x0; x <= x1; ++x) {
+                float dx = x + 0.5f - cx;
+                float u = (dx * cs + dy * sn + half) * sx;
+                float v = (-dx * sn + dy * cs + half) * sy;
+                Color t = BLANK;
+                if (u >= 0.f && v >= 0.f && u < s.w && v < s.h) {
+                    t = s.px[(size_t)(int)v * s.w + (int)u];
+                    if (alpha != 255) t.a = (unsigned char)div255(t.a * alpha);
+                }
+                row[x - x0] = t;
+            }
+            blendRow(line(y) + x0, row.data(), x1 - x0 + 1, blend);
+        }
+    }
+
+    // Métrica aproximada a la fuente por defecto de raylib (base 10 px)
+    static int measureText(const char* text, int size) {
+        int n = (int)std::strlen(text);
+        if (n == 0) return 0;
+        float sc = size / 10.f;
+        return (int)(n * 5.f * sc) + (n - 1) * (size / 10);
+    }
+
+    void text(const char* text, int x, int y, int size, Color c) {
+        float sc = size / 10.f;
+        float advance = 5.f * sc + (float)(size / 10);
+        int top = y + (int)std::lround(sc);
+        int gh  = std::max(1, (int)std::lround(7.f * sc));
+        float pen = (float)x;
+        for (const char* p = text; *p; ++p, pen += advance) {
+            const SoftGlyph* g = softGlyph(*p);
+            if (!g) continue;
+            for (int ry = 0; ry < gh; ++ry) {
+                uint8_t bits = g->rows[std::min(6, (int)(ry / sc))];
+                for (int col = 0; col < 5; ++col) {
+                    if (!(bits & (0x10 >> col))) continue;
+                    int end = col;
+                    while (end + 1 < 5 && (bits & (0x10 >> (end + 1)))) ++end;
+                    span(top + ry, (int)std::lround(pen + col * sc), (int)std::lround(pen + (end + 1) * sc), c);
+                    col = end;
+                }
+            }
+        }
+    }
+
+    // Luminancia 8-bit promediando bloques div x div
+    void toLuma(uint8_t* out, int div) const {
+        const int ow = SW / div, oh = SH / div;
+        const int n = div * div;
+        for (int oy = 0; oy < oh; ++oy) {
+            for (int ox = 0; ox < ow; ++ox) {
+                int sum = 0;
+                for (int y = oy * div; y < (oy + 1) * div; ++y) {
+                    const Color* p = px.data() + (size_t)y * SW + ox * div;
+                    for (int x = 0; x < div; ++x) sum += (77 * p[x].r + 150 * p[x].g + 29 * p[x].b) >> 8;
+                }
+                out[oy * ow + ox] = (uint8_t)(sum / n);
+            }
+        }
+    }
+};
+
+// Mirror of Game::draw (same order, colours and blend modes) onto a SoftCanvas.
+// Sprites that failed to load are drawn as flat discs so observations never
+// lose an entity.
+struct SoftScene {
+    const Game&        g;
+    SoftCanvas&        cv;
+    const SoftSprites& spr;
+    float              alpha;
+
+    float lerp(float prev, float cur) const { return prev + (cur - prev) * alpha; }
+
+    void spriteOr(const SoftSprite& s, float cx, float cy, float size, float rot, Color fallback, unsigned char a = 255) {
+        if (s.w != 0) cv.sprite(s, cx, cy, size, rot, a);
+        else          cv.circle(cx, cy, size * 0.35f, fallback);
+    }
+
+    static Color enemyColor(int set) {
+        if (set == 1) return {255, 80, 40, 255};
+        if (set == 2) return {80, 230, 90, 255};
+        return {190, 90, 255, 255};
+    }
+
+    void draw() {
+        cv.resetClip();
+        cv.blend = SoftBlend::ALPHA;
+        cv.clear(BLACK);
+        g.stars.forEach([&](float x, float y, const StarLayer& l) {
+            unsigned char b = l.brightness;
+            cv.rect((int)x, (int)y, (int)l.size, (int)l.size, {b, b, b, 255});
+        });
+
+        switch (g.state) {
+            case GameState::ATTRACT:       attract();     break;
+            case GameState::PLAYING:       playing();     break;
+            case GameState::PLAYER_DEAD:   enemies(); hud(); break;
+            case GameState::GAME_OVER:     gameOver();    break;
+            case GameState::STAGE_CLEAR:   clear();       break;
+        }
+        effects();
+    }
+
+    void centeredText(const char* s, int y, int size, Color c) {
+        cv.text(s, SW/2 - SoftCanvas::measureText(s, size)/2, y, size, c);
+    }
+
+    void hud() {
+        char buf[32];
+        const Player& p = g.player;
+        std::snprintf(buf, sizeof buf, "%06d", g.score);
+        cv.text(buf, 10, 10, 20, WHITE);
+
+        cv.text("HIGH SCORE", SW/2 - 50, 8, 14, WHITE);
+        std::snprintf(buf, sizeof buf, "%06d", g.highScore);
+        cv.text(buf, SW/2 - 30, 22, 14, WHITE);
+        if (p.hasPowerUp) {
+            float ratio = (p.powerUpMaxDuration > 0.f) ? p.powerUpTimer / p.powerUpMaxDuration : 0.f;
+            Color barCol = (ratio > 0.35f) ? Color{120, 255, 120, 255} : Color{255, 160, 40, 255};
+            std::snprintf(buf, sizeof buf, "SHOT x%d", p.shotLevel);
+            cv.text(buf, 10, 34, 14, barCol);
+            cv.rect(10, 52, 60, 5, {60, 60, 60, 200});
+            cv.rect(10, 52, (int)(60.f * ratio), 5, barCol);
+        } else {
+            cv.text("SHOT x1", 10, 34, 14, {160, 160, 160, 200});
+        }
+
+        for (int i = 0; i < p.lives; ++i)
+            spriteOr(spr.playerLife, std::roundf(20.f + i * 28.f), std::roundf(SH - 18.f), LIFE_ICON_SIZE, 0.f, {200, 220, 255, 255});
+        if (g.coop) {
+            for (int i = 0; i < g.player2.lives; ++i)
+                spriteOr(spr.playerLife, std::roundf(SW / 2.f + 20.f + i * 28.f), std::roundf(SH - 18.f), LIFE_ICON_SIZE, 0.f, {200, 220, 255, 255});
+        }
+
+        for (int i = 0; i < g.round && i < 8; ++i) {
+            Color fc = {(unsigned char)(100 + i*20), 80, 200, 255};
+            cv.rect(SW - 20 - i*16, SH - 26, 12, 16, fc);
+        }
+    }
+
+    void enemies() {
+        const Boss& boss = g.boss;
+        if (boss.active) {
+            AnimFrame f = bossAnimFrame(g.anim, boss.type);
+            spriteOr(spr.enemyFrame(f.set, f.index), std::roundf(lerp(boss.prevX, boss.x)), std::roundf(boss.y),
+                     boss.size, 0.f, enemyColor(f.set));
+
+            float bw = 180.f, bh = 8.f;
+            float bx = SW * 0.5f - bw * 0.5f;
+            float by = 52.f;
+            float pct = (boss.maxHp > 0) ? (float)boss.hp / (float)boss.maxHp : 0.f;
+            cv.rect((int)bx, (int)by, (int)bw, (int)bh, {70, 70, 70, 220});
+            cv.rect((int)bx, (int)by, (int)(bw * std::clamp(pct, 0.f, 1.f)), (int)bh, {255, 90, 90, 255});
+            cv.text("BOSS", (int)bx, (int)by - 14, 12, {255, 180, 180, 255});
+        }
+
+        const EnemyStore& es = g.enemies;
+        for (int i = 0; i < es.alive; ++i) {
+            float ex = lerp(es.prevX[i], es.x[i]);
+            float ey = lerp(es.prevY[i], es.y[i]);
+            float rot = enemyBaseRotation(es.type[i]);
+            if (es.state(i) == EnemyState::DIVING) rot += es.heading[i];
+            AnimFrame f = enemyAnimFrame(g.anim, es.type[i], es.col[i]);
+            spriteOr(spr.enemyFrame(f.set, f.index), ex, ey, ENEMY_DRAW_SIZE, rot, enemyColor(f.set));
+        }
+    }
+
+    void bullets() {
+        cv.blend = SoftBlend::ADDITIVE;
+        for (const auto& b : g.pBullets) {
+            float bx = lerp(b.prevX, b.x);
+            float by = lerp(b.prevY, b.y);
+            cv.circleGradient((float)(int)bx, (float)(int)(by - BULLET_H * 0.3f),
+                BULLET_W * 3.f, {255, 255, 180, 70}, {255, 255, 80, 0});
+            cv.rectGradientV((int)(bx - BULLET_W/2), (int)(by - BULLET_H/2), (int)BULLET_W, (int)BULLET_H,
+                {255, 255, 255, 255}, {255, 210, 30, 200});
+        }
+        for (const auto& b : g.eBullets) {
+            float bx = lerp(b.prevX, b.x);
+            float by = lerp(b.prevY, b.y);
+            cv.circleGradient((float)(int)bx, (float)(int)(by + EBULLET_H * 0.3f),
+                EBULLET_W * 3.f, {255, 60, 0, 80}, {255, 30, 0, 0});
+            cv.rectGradientV((int)(bx - EBULLET_W/2), (int)(by - EBULLET_H/2), (int)EBULLET_W, (int)EBULLET_H,
+                {255, 180, 40, 200}, {255, 30, 0, 255});
+        }
+        cv.blend = SoftBlend::ALPHA;
+    }
+
+    void powerUps() {
+        for (const auto& p : g.powerUps) {
+            Color c = {120, 220, 255, 255};
+            const char* label = "F";
+            if (p.type == PowerUpType::DOUBLE_SHOT) { c = {255, 220, 120, 255}; label = "2"; }
+            if (p.type == PowerUpType::TRIPLE_SHOT) { c = {255, 140, 120, 255}; label = "3"; }
+            cv.circle((float)(int)p.x, (float)(int)p.y, 8.f, c);
+            cv.text(label, (int)p.x - 4, (int)p.y - 6, 12, BLACK);
+        }
+    }
+
+    void playerShip(float cx, float cy, float vx, float thrusterTime) {
+        const float size = PLAYER_DRAW_SIZE;
+        float sx = std::roundf(cx), sy = std::roundf(cy);
+        if (spr.playerThrusters.w != 0) {
+            ThrusterLevels lv = thrusterLevels(vx, thrusterTime);
+            int ix = (int)sx, iy = (int)sy, half = (int)(size * 0.5f), isize = (int)size;
+            cv.setClip(ix - half, iy - half, half, isize);
+            cv.sprite(spr.playerThrusters, cx, cy, size, 0.f, (unsigned char)(lv.left * 255.f));
+            cv.setClip(ix, iy - half, half, isize);
+            cv.sprite(spr.playerThrusters, cx, cy, size, 0.f, (unsigned char)(lv.right * 255.f));
+            if (lv.glowSide != 0) {
+                cv.blend = SoftBlend::ADDITIVE;
+                cv.setClip(lv.glowSide < 0 ? ix - half : ix, iy - half, half, isize);
+                cv.sprite(spr.playerThrusters, cx, cy, size, 0.f, (unsigned char)(lv.glow * 255.f));
+                cv.blend = SoftBlend::ALPHA;
+            }
+            cv.resetClip();
+        }
+        const SoftSprite& body = spr.playerBody.w != 0 ? spr.playerBody : spr.player;
+        spriteOr(body, sx, sy, size, 0.f, {200, 220, 255, 255});
+    }
+
+    void playing() {
+        enemies();
+        bullets();
+        powerUps();
+        for (int i = 0; i < g.shipCount(); ++i) {
+            const Player& p = g.ship(i);
+            bool showPlayer = p.alive && (!p.invincible || (int)(p.invTimer * 10) % 2 == 0);
+            if (showPlayer) playerShip(lerp(p.prevX, p.x), p.y, p.vx, p.thrusterTime);
+        }
+        hud();
+    }
+
+    void gameOver() {
+        enemies();
+        hud();
+        centeredText("GAME OVER", SH/2 - 20, 40, RED);
+    }
+
+    void attract() {
+        centeredText("GALAX IA", 40, 48, {255, 220, 50, 255});
+        enemies();
+        char buf[32];
+        cv.text("HIGH SCORE", SW/2 - 50, SH/2 - 30, 16, WHITE);
+        std::snprintf(buf, sizeof buf, "%06d", g.highScore);
+        cv.text(buf, SW/2 - 36, SH/2 - 10, 20, WHITE);
+        if (g.blinkOn) centeredText("PRESS ENTER TO PLAY", SH*3/4, 18, {200, 200, 200, 255});
+        cv.text("MOVE: ARROWS / A-D    FIRE: SPACE", 30, SH - 36, 12, {150,150,150,255});
+    }
+
+    void clear() {
+        if ((int)(g.flashTimer * 8) % 2 == 0) cv.rect(0, 0, SW, SH, {255,255,255, 60});
+        centeredText("STAGE CLEAR!", SH/2 - 18, 36, {100, 255, 100, 255});
+        hud();
+    }
+
+    void effects() {
+        const Effects& fx = g.fx;
+        cv.blend = SoftBlend::ADDITIVE;
+        const FlashPool& fl = fx.flashes;
+        for (int i = 0; i < fl.count; ++i) {
+            float t = fl.life[i] / fl.maxLife[i];
+            float r = fl.radius[i] * (0.9f + t * 0.4f);
+            cv.circleGradient((float)(int)fl.x[i], (float)(int)fl.y[i], r,
+                {255, 255, 255, (unsigned char)(t * 230)}, {255, 180, 20, 0});
+            float ringR = fl.radius[i] * (1.0f + (1.0f - t) * 2.2f);
+            cv.ring(fl.x[i], fl.y[i], ringR - 1.5f, ringR + 1.5f, {255, 200, 60, (unsigned char)(t * 160)});
+        }
+        const ParticlePool& p = fx.particles;
+        for (int i = 0; i < p.count; ++i) {
+            float t = p.life[i] / p.maxLife[i];
+            Color pc = p.color[i];
+            Color c = {pc.r, pc.g, pc.b, (unsigned char)(t * 255)};
+            if (p.type[i] == ParticleType::SPARK) {
+                float len = p.size[i] * 5.f * t;
+                float mag = sqrtf(p.vx[i] * p.vx[i] + p.vy[i] * p.vy[i]);
+                if (mag > 0.f) {
+                    float nx = p.vx[i] / mag, ny = p.vy[i] / mag;
+                    cv.lineEx({p.x[i] - nx * len, p.y[i] - ny * len}, {p.x[i], p.y[i]}, 1.5f, c);
+                }
+            } else {
+                float sz = p.size[i] * (0.4f + 0.6f * t);
+                cv.circleGradient((float)(int)p.x[i], (float)(int)p.y[i], sz, c, {pc.r, pc.g, pc.b, 0});
+            }
+        }
+        cv.blend = SoftBlend::ALPHA;
+        const DebrisPool& d = fx.debris;
+        for (int i = 0; i < d.count; ++i) {
+            float t = d.life[i] / d.maxLife[i];
+            Color c = {d.color[i].r, d.color[i].g, d.color[i].b, (unsigned char)(t * 230)};
+            cv.rectPro({d.x[i], d.y[i], d.w[i], d.h[i]}, {d.w[i] * 0.5f, d.h[i] * 0.5f}, d.rot[i], c);
+        }
+    }
+};
+
+static void renderSoft(const Game& g, SoftCanvas& cv, float alpha = 1.f) {
+    SoftScene{g, cv, softSprites(), std::clamp(alpha, 0.f, 1.f)}.draw();
+}
+
+// ─────────────────────────────────────────────────────────────
+//  GYM ENVIRONMENT (C ABI)
+// ─────────────────────────────────────────────────────────────
+// Built as a shared library with -DGALAXIAN_GYM (no main(), no window):
+//
+//   g++ -std=c++17 -O2 -pthread -shared -fPIC -DGALAXIAN_GYM -o libgalaxian_gym.so
+//       main.cpp $(pkg-config --cflags --libs raylib) -lm
+//
+// One handle steps a batch of N independent games in a single call. Handles
+// share no state, so callers may drive several handles from their own
+// threads. Actions use the replay input bits: 1 = left, 2 = right, 4 = fire.
+//
+// Feature vector (GX_FEATURES floats per env, roughly in -1..1):
+//   [0..8]   player x, vx, lives, alive, invincible, shot level, shot ready,
+//            round, alive enemies (fraction of the formation)
+//   [9..11]  boss active, boss dx, boss hp ratio
+//   next     GX_OBS_BULLETS nearest enemy bullets: present, dx, dy, vx, vy
+//   next     GX_OBS_DIVERS nearest diving/returning enemies: present, dx, dy
+// Frame (optional): GX_FRAME_W x GX_FRAME_H 8-bit luminance per env, box
+// filtered from the software renderer; gx_render returns the full RGBA frame.
+#if defined(_WIN32)
+    #define GX_API extern "C" __declspec(dllexport)
+#else
+    #define GX_API extern "C" __attribute__((visibility("default")))
+#endif
+
+static constexpr int GX_OBS_BULLETS = 8;
+static constexpr int GX_OBS_DIVERS  = 6;
+static constexpr int GX_FEATURES    = 12 + GX_OBS_BULLETS * 5 + GX_OBS_DIVERS * 3;
+static constexpr int GX_FRAME_DIV   = 5;
+static constexpr int GX_FRAME_W     = SW / GX_FRAME_DIV;
+static constexpr int GX_FRAME_H     = SH / GX_FRAME_DIV;
+
+static void writeFeatures(const Game& g, float* out) {
+    const Player& p = g.player;
+    float* f = out;
+    *f++ = p.x / SW * 2.f - 1.f;
+    *f++ = p.vx / PLAYER_MAX_SPEED;
+    *f++ = p.lives / 3.f;
+    *f++ = p.alive ? 1.f : 0.f;
+    *f++ = p.invincible ? 1.f : 0.f;
+    *f++ = p.shotLevel / 3.f;
+    *f++ = p.shotTimer <= 0.f ? 1.f : 0.f;
+    *f++ = std::min(g.round, 20) / 20.f;
+    *f++ = (float)g.aliveCount() / std::max(1, g.enemies.count);
+    *f++ = g.boss.active ? 1.f : 0.f;
+    *f++ = g.boss.active ? (g.boss.x - p.x) / SW : 0.f;
+    *f++ = (g.boss.active && g.boss.maxHp > 0) ? (float)g.boss.hp / g.boss.maxHp : 0.f;
+
+    // Nearest-k by squared distance to the player (partial selection)
+    auto nearest = [&](std::vector<int>& idx, int k, auto&& dist2) {
+        k = std::min(k, (int)idx.size());
+        std::partial_sort(idx.begin(), idx.begin() + k, idx.end(),
+            [&](int a, int b) { return dist2(a) < dist2(b); });
+        idx.resize(k);
+    };
+
+    static thread_local std::vector<int> idx;
+    idx.clear();
+    for (int i = 0; i < g.eBullets.size(); ++i) idx.push_back(i);
+    nearest(idx, GX_OBS_BULLETS, [&](int i) {
+        float dx = g.eBullets[i].x - p.x, dy = g.eBullets[i].y - p.y;
+        return dx * dx + dy * dy;
+    });
+    for (int k = 0; k < GX_OBS_BULLETS; ++k) {
+        if (k < (int)idx.size()) {
+            const Bullet& b = g.eBullets[idx[k]];
+            *f++ = 1.f;
+            *f++ = (b.x - p.x) / SW;
+            *f++ = (b.y - p.y) / SH;
+            *f++ = b.vx / 400.f;
+            *f++ = b.vy / 400.f;
+        } else {
+            for (int z = 0; z < 5; ++z) *f++ = 0.f;
+        }
+    }
+
+    idx.clear();
+    const EnemyStore& es = g.enemies;
+    for (int i = es.formEnd; i < es.alive; ++i) idx.push_back(i);
+    nearest(idx, GX_OBS_DIVERS, [&](int i) {
+        float dx = es.x[i] - p.x, dy = es.y[i] - p.y;
+        return dx * dx + dy * dy;
+    });
+    for (int k = 0; k < GX_OBS_DIVERS; ++k) {
+        if (k < (int)idx.size()) {
+            *f++ = 1.f;
+            *f++ = (es.x[idx[k]] - p.x) / SW;
+            *f++ = (es.y[idx[k]] - p.y) / SH;
+        } else {
+            for (int z = 0; z < 3; ++z) *f++ = 0.f;
+        }
+    }
+}
+
+struct GxVecEnv {
+    std::vector<Game>     games;
+    std::vector<uint64_t> seeds;
+    int  frameSkip = 4;
+    int  simHz     = SIM_HZ_DEFAULT;
+    bool autoReset = true;
+    mutable SoftCanvas canvas;   // scratch for rendered observations
+
+    void resetOne(int i, uint64_t seed) {
+        Game& g = games[i];
+        g = Game{};
+        seeds[i] = seed;
+        g.boot(seed);
+        g.startAtRound(1);
+    }
+};
+
+GX_API GxVecEnv* gx_create(int numEnvs, int simHz, int frameSkip, int autoReset) {
+    if (numEnvs <= 0) return nullptr;
+    GxVecEnv* env = new GxVecEnv;
+    env->games.resize(numEnvs);
+    env->seeds.resize(numEnvs, 0);
+    env->simHz     = simHz > 0 ? simHz : SIM_HZ_DEFAULT;
+    env->frameSkip = std::max(1, frameSkip);
+    env->autoReset = autoReset != 0;
+    for (int i = 0; i < numEnvs; ++i) env->resetOne(i, (uint64_t)i + 1);
+    return env;
+}
+
+GX_API void gx_destroy(GxVecEnv* env) { delete env; }
+
+GX_API int gx_num_envs(const GxVecEnv* env) { return env ? (int)env->games.size() : 0; }
+GX_API int gx_feature_size(void) { return GX_FEATURES; }
+GX_API int gx_frame_width(void)  { return GX_FRAME_W; }
+GX_API int gx_frame_height(void) { return GX_FRAME_H; }
+
+// seeds: numEnvs values, or NULL to use 1..numEnvs
+GX_API void gx_reset(GxVecEnv* env, const uint64_t* seeds) {
+    if (!env) return;
+    for (int i = 0; i < (int)env->games.size(); ++i)
+        env->resetOne(i, seeds ? seeds[i] : (uint64_t)i + 1);
+}
+
+GX_API void gx_reset_one(GxVecEnv* env, int index, uint64_t seed) {
+    if (env && index >= 0 && index < (int)env->games.size()) env->resetOne(index, seed);
+}
+
+// Advances every env by frameSkip ticks with its action. rewards: score
+// gained (float[numEnvs]); dones: 1 when the game ended (uint8[numEnvs]).
+// With autoReset a finished env restarts at once on seed + numEnvs, so the
+// next gx_observe already shows the new episode. Either output may be NULL.
+GX_API void gx_step(GxVecEnv* env, const uint8_t* actions, float* rewards, uint8_t* dones) {
+    if (!env) return;
+    const float dt = 1.f / env->simHz;
+    const int n = (int)env->games.size();
+    for (int i = 0; i < n; ++i) {
+        Game& g = env->games[i];
+        int before = g.score;
+        bool done  = g.state == GameState::GAME_OVER;
+        InputFrame in = unpackInput(actions ? actions[i] : 0);
+        in.start = false;
+        for (int k = 0; k < env->frameSkip && !done; ++k) {
+            g.update(dt, in);
+            in.fire = false;   // disparo por flanco: solo en el primer tick
+            done = g.state == GameState::GAME_OVER;
+        }
+        if (rewards) rewards[i] = (float)(g.score - before);
+        if (dones)   dones[i]   = done ? 1 : 0;
+        if (done && env->autoReset) env->resetOne(i, env->seeds[i] + (uint64_t)n);
+    }
+}
+
+// features: float[numEnvs * gx_feature_size()]; frames: optional
+// uint8[numEnvs * gx_frame_width() * gx_frame_height()], may be NULL.
+GX_API void gx_observe(const GxVecEnv* env, float* features, uint8_t* frames) {
+    if (!env) return;
+    for (int i = 0; i < (int)env->games.size(); ++i) {
+        if (features) writeFeatures(env->games[i], features + (size_t)i * GX_FEATURES);
+        if (frames) {
+            renderSoft(env->games[i], env->canvas);
+            env->canvas.toLuma(frames + (size_t)i * GX_FRAME_W * GX_FRAME_H, GX_FRAME_DIV);
+        }
+    }
+}
+
+// Full-resolution frame of one env: rgba is uint8[480 * 720 * 4], row-major RGBA8.
+GX_API void gx_render(const GxVecEnv* env, int index, uint8_t* rgba) {
+    if (!env || !rgba || index < 0 || index >= (int)env->games.size()) return;
+    renderSoft(env->games[index], env->canvas);
+    std::memcpy(rgba, env->canvas.px.data(), env->canvas.px.size() * sizeof(Color));
+}
+
+#ifndef GALAXIAN_GYM
+
+// ─────────────────────────────────────────────────────────────
+//  CO-OP NETPLAY (ROLLBACK)
+// ─────────────────────────────────────────────────────────────
+// Each peer runs the whole game and owns one ship. Local input is applied at
+// once; the remote ship uses a prediction (last input the peer sent, with
+// the fire/start edges cleared). When a real input disagrees with the
+// prediction, the peer restores the snapshot taken before that tick and
+// re-simulates up to the present within the same frame. Snapshots live in
+// preallocated buffers (saveState reuses capacity), so once the game's
+// vectors reach their high-water mark a rollback does not allocate.
+//
+// Packet (little-endian): u32 firstTick, u8 count, count x u8 input,
+//   u32 ack (remote inputs received so far), u32 checkTick, u64 checkHash.
+// Every packet repeats all inputs the peer has not acknowledged yet, so a
+// lost or reordered packet costs nothing but latency. checkTick/checkHash
+// is Game::tickHash after the newest tick both inputs are known for; the
+// peer compares it with its own to detect desyncs.
+static constexpr int NET_MAX_ROLLBACK = 16;   // ticks of prediction before stalling
+static constexpr int NET_RING         = 64;   // history slots (> 2 x NET_MAX_ROLLBACK)
+static constexpr int NET_MAX_PACKET   = 21 + NET_RING;
+
+struct NetTransport {
+    virtual ~NetTransport() = default;
+    virtual void send(const uint8_t* data, size_t size) = 0;
+    virtual int  receive(uint8_t* buf, size_t cap) = 0;   // bytes read, 0 = nothing pending
+};
+
+// In-process link between two endpoints with latency, jitter and loss counted
+// in ticks. Deterministic for a given seed, so --coop-sim runs reproduce.
+struct SimChannel {
+    struct Packet {
+        uint32_t deliverAt;
+        uint32_t size;
+        uint8_t  bytes[NET_MAX_PACKET];
+    };
+    std::vector<Packet> queue[2];   // queue[i]: packets travelling to endpoint i
+    uint32_t now     = 0;
+    int      latency = 6;
+    int      jitter  = 2;
+    int      lossPct = 5;
+    RngStream rng;
+    uint64_t sent = 0, dropped = 0;
+
+    void start(uint64_t seed) {
+        rng = {GameRng::streamKey(seed, GameRng::POLICY, 0x4e4554), 0};
+        for (auto& q : queue) { q.clear(); q.reserve(4 * NET_RING); }
     }
 
-    void updateFormationMotion(float dt) {
-        float sf = (state == GameState::PLAYING) ? speedFactor() : 1.f;
-        float dir = (formVX >= 0.f) ? 1.f : -1.f;
-        float speed = std::abs(formVX) * sf;
+    void push(int to, const uint8_t* data, size_t size) {
+        ++sent;
+        if (size > NET_MAX_PACKET) return;
+        if (lossPct > 0 && rng.range(0, 99) < lossPct) { ++dropped; return; }
+        Packet p;
+        p.deliverAt = now + (uint32_t)std::max(0, latency + (jitter > 0 ? rng.range(-jitter, jitter) : 0));
+        p.size = (uint32_t)size;
+        std::memcpy(p.bytes, data, size);
+        queue[to].push_back(p);
+    }
 
-        // Edges (soft turn near borders to avoid harsh direction changes)
-        float maxX = (float)(SW - COLS * CELL_W) / 2.f - 10.f;
-        float distToEdge = (dir > 0.f) ? (maxX - formOffX) : (formOffX + maxX);
-        const float softZone = 26.f;
-        float edgeFactor = 1.f;
-        if (distToEdge < softZone) {
-            edgeFactor = std::clamp(distToEdge / softZone, 0.35f, 1.f);
-        }
+    // Earliest due packet for endpoint `to` (jitter may reorder them)
+    int pop(int to, uint8_t* buf, size_t cap) {
+        auto& q = queue[to];
+        int best = -1;
+        for (int i = 0; i < (int)q.size(); ++i)
+            if (q[i].deliverAt <= now && (best < 0 || q[i].deliverAt < q[best].deliverAt)) best = i;
+        if (best < 0) return 0;
+        int n = (int)std::min<size_t>(q[best].size, cap);
+        std::memcpy(buf, q[best].bytes, n);
+        q[best] = q.back();
+        q.pop_back();
+        return n;
+    }
+};
 
-        formOffX += dir * speed * edgeFactor * dt;
+struct SimEndpoint : NetTransport {
+    SimChannel* ch   = nullptr;
+    int         side = 0;
+    void send(const uint8_t* data, size_t size) override { ch->push(1 - side, data, size); }
+    int  receive(uint8_t* buf, size_t cap) override { return ch->pop(side, buf, cap); }
+};
 
-        if (formOffX > maxX) {
-            float overshoot = formOffX - maxX;
-            formOffX = maxX - overshoot;
-            formVX = -std::abs(formVX);
-        }
-        if (formOffX < -maxX) {
-            float overshoot = -maxX - formOffX;
-            formOffX = -maxX + overshoot;
-            formVX = std::abs(formVX);
+#if GX_HAS_UDP
+// Non-blocking UDP between two ports on 127.0.0.1 (two processes, one
+// machine: the two-seat cabinet).
+struct UdpTransport : NetTransport {
+    int         fd = -1;
+    sockaddr_in peer = {};
+
+    bool open(int localPort, int remotePort) {
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) return false;
+        sockaddr_in local = {};
+        local.sin_family      = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        local.sin_port        = htons((uint16_t)localPort);
+        if (bind(fd, (const sockaddr*)&local, sizeof local) != 0 ||
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) != 0) {
+            close();
+            return false;
         }
+        peer = local;
+        peer.sin_port = htons((uint16_t)remotePort);
+        return true;
+    }
 
-        // Vertical bobbing (Galaxian-like subtle up/down movement)
-        formSineT += dt;
-        formOffY  = sinf(formSineT * FORM_BOB_FREQ) * FORM_BOB_AMP;
+    void close() {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
     }
 
-    void updateDiving(Enemy& e, float dt) {
-        // Advance t based on speed / curve length approximation
-        float arcLen = 600.f; // rough estimate
-        e.t += (e.diveSpeed / arcLen) * dt;
+    ~UdpTransport() override { close(); }
 
-        if (e.t >= 1.f) {
-            e.t = 1.f;
-            // Exited bottom – start return
-            e.x = bezier(e.p0, e.p1, e.p2, e.p3, 1.f).x;
-            e.y = (float)SH + 60.f;
-            returnToFormation(e);
-            return;
-        }
+    void send(const uint8_t* data, size_t size) override {
+        if (fd >= 0) sendto(fd, data, size, 0, (const sockaddr*)&peer, sizeof peer);
+    }
 
-        Vector2 pos = bezier(e.p0, e.p1, e.p2, e.p3, e.t);
-        e.x = pos.x;
-        e.y = pos.y;
+    int receive(uint8_t* buf, size_t cap) override {
+        if (fd < 0) return 0;
+        ssize_t n = recv(fd, buf, cap, 0);
+        return n > 0 ? (int)n : 0;
+    }
+};
+#endif
+
+struct RollbackSession {
+    Game*         game = nullptr;
+    NetTransport* link = nullptr;
+    int      localSlot = 0;        // 0 = player, 1 = player2
+    float    dt        = 1.f / SIM_HZ_DEFAULT;
+
+    uint32_t tick        = 0;      // next tick to simulate
+    uint32_t remoteKnown = 0;      // remote inputs [0, remoteKnown) have arrived
+    uint32_t peerAck     = 0;      // the peer has our inputs [0, peerAck)
+    uint32_t syncTick    = 0;      // ticks [0, syncTick) are final on this peer
+    uint64_t syncHash    = 0;      // Game::tickHash after tick syncTick - 1
+
+    uint8_t  localIn[NET_RING]   = {};
+    uint8_t  remoteIn[NET_RING]  = {};
+    uint8_t  usedRemote[NET_RING] = {};   // remote input the last simulation of a tick used
+    uint64_t hashes[NET_RING]    = {};    // Game::tickHash after each tick
+    std::vector<uint8_t> snaps[NET_RING]; // state before each tick
+    std::vector<uint8_t> packet;
+
+    // Stats
+    uint32_t rollbacks = 0, resimTicks = 0, maxRollback = 0, stalls = 0, desyncs = 0;
+    double   rollbackUs = 0.0;
+
+    void start(Game& g, NetTransport& t, int slot, int simHz) {
+        *this = RollbackSession{};
+        game = &g;
+        link = &t;
+        localSlot = slot;
+        dt = 1.f / simHz;
+        // Reserve snapshot space up front so rollbacks do not allocate
+        g.saveState(packet);
+        for (auto& s : snaps) s.reserve(packet.size() * 2 + 4096);
+        packet.clear();
+        packet.reserve(NET_MAX_PACKET);
+    }
 
-        // Shoot
-        if (e.bulletsLeft > 0) {
-            e.shootTimer -= dt;
-            if (e.shootTimer <= 0.f) {
-                e.shootTimer = e.shootInterval;
-                e.bulletsLeft--;
-                Bullet b;
-                b.active = true;
-                b.enemy  = true;
-                b.x      = e.x;
-                b.y      = e.y + 8.f;
-                b.vx     = 0.f;
-                float eBulletSpd = EBULLET_SPEED_BASE + round * 12.f;
-                b.vy     = eBulletSpd;
-                // Aim mejora progresivamente con las rondas (0.25 ronda 1 → 0.55 ronda 7+)
-                float aimFactor = std::min(0.25f + (round - 1) * 0.05f, 0.55f);
-                float dx = player.x - e.x;
-                float dist = std::abs(dx) + 200.f;
-                b.vx = (dx / dist) * eBulletSpd * aimFactor;
-                eBullets.push_back(b);
+    uint8_t predictRemote() const {
+        uint8_t last = remoteKnown > 0 ? remoteIn[(remoteKnown - 1) % NET_RING] : 0;
+        return (uint8_t)(last & 3);   // held directions repeat, edges do not
+    }
+
+    void simulate(uint32_t t) {
+        Game& g = *game;
+        int k = t % NET_RING;
+        g.saveState(snaps[k]);
+        uint8_t remote = t < remoteKnown ? remoteIn[k] : predictRemote();
+        usedRemote[k] = remote;
+        InputFrame mine = unpackInput(localIn[k]), theirs = unpackInput(remote);
+        if (localSlot == 0) g.update(dt, mine, theirs);
+        else                g.update(dt, theirs, mine);
+        hashes[k] = g.tickHash;
+    }
+
+    // Reads every pending packet; rolls back if a prediction was wrong.
+    void poll() {
+        uint8_t buf[NET_MAX_PACKET];
+        uint32_t rollbackTo = tick;
+        int n;
+        while ((n = link->receive(buf, sizeof buf)) > 0) {
+            ByteReader r{buf, buf + n};
+            uint32_t first = r.u32();
+            int count = r.u8();
+            if (!r.need((size_t)count)) continue;
+            const uint8_t* inputs = r.p;
+            r.p += count;
+            uint32_t ack = r.u32();
+            uint32_t checkTick = r.u32();
+            uint64_t checkHash = r.u64();
+            if (!r.ok) continue;
+
+            peerAck = std::max(peerAck, std::min(ack, tick));
+            for (int i = 0; i < count; ++i) {
+                uint32_t t = first + (uint32_t)i;
+                if (t < remoteKnown) continue;
+                if (t > remoteKnown || t >= tick + NET_RING - NET_MAX_ROLLBACK) break;
+                remoteIn[t % NET_RING] = inputs[i];
+                remoteKnown = t + 1;
+                if (t < tick && usedRemote[t % NET_RING] != inputs[i]) rollbackTo = std::min(rollbackTo, t);
             }
+            // Only comparable while our own hash for checkTick is final and still in the ring
+            if (checkTick > 0 && checkTick <= syncTick && checkTick + NET_RING > tick &&
+                hashes[(checkTick - 1) % NET_RING] != checkHash)
+                ++desyncs;
         }
+        if (rollbackTo < tick) rollback(rollbackTo);
+    }
+
+    void rollback(uint32_t from) {
+        auto t0 = std::chrono::steady_clock::now();
+        game->loadState(snaps[from % NET_RING]);
+        for (uint32_t t = from; t < tick; ++t) simulate(t);
+        rollbackUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+        ++rollbacks;
+        resimTicks += tick - from;
+        maxRollback = std::max(maxRollback, tick - from);
     }
 
-    void updateReturning(Enemy& e, float dt) {
-        float arcLen = 700.f;
-        e.retT += (e.diveSpeed * 0.8f / arcLen) * dt;
+    void confirm() {
+        uint32_t upTo = std::min(remoteKnown, tick);
+        if (upTo > syncTick) {
+            syncTick = upTo;
+            syncHash = hashes[(upTo - 1) % NET_RING];
+        }
+    }
 
-        // Keep destination updated with current formation position
-        e.retP3 = {formationX(e.col), formationY(e.row, e.col)};
+    void sendInputs() {
+        uint32_t first = std::max(peerAck, tick > NET_RING - 1 ? tick - (NET_RING - 1) : 0u);
+        packet.clear();
+        ByteWriter w{packet};
+        w.u32(first);
+        w.u8((uint8_t)(tick - first));
+        for (uint32_t t = first; t < tick; ++t) w.u8(localIn[t % NET_RING]);
+        w.u32(remoteKnown);
+        w.u32(syncTick);
+        w.u64(syncHash);
+        link->send(packet.data(), packet.size());
+    }
 
-        if (e.retT >= 1.f) {
-            e.retT  = 1.f;
-            e.state = EnemyState::IN_FORMATION;
-            e.x     = e.retP3.x;
-            e.y     = e.retP3.y;
-            return;
+    // One tick with this peer's input. Returns false (nothing simulated) when
+    // the peer is NET_MAX_ROLLBACK ticks behind: the caller keeps the input
+    // and retries next frame.
+    bool advance(const InputFrame& in) {
+        poll();
+        if (tick >= remoteKnown + NET_MAX_ROLLBACK) {
+            ++stalls;
+            sendInputs();
+            return false;
         }
+        localIn[tick % NET_RING] = packInput(in);
+        simulate(tick);
+        ++tick;
+        confirm();
+        sendInputs();
+        return true;
+    }
 
-        Vector2 pos = bezier(e.retP0, e.retP1, e.retP2, e.retP3, e.retT);
-        e.x = pos.x;
-        e.y = pos.y;
+    // Exchange packets without simulating a new tick (frames spent stalled,
+    // or draining at the end of a session).
+    void pump() {
+        poll();
+        confirm();
+        sendInputs();
     }
+};
 
-    void killPlayer() {
-        if (player.invincible) return;
-        spawnExplosion(player.x, player.y, true, EnemyType::ZAKO_BLUE, true);
-        player.lives--;
-        player.alive = false;
-        player.shotLevel = 1;
-        player.shotCooldown = 0.22f;
-        player.shotTimer = 0.f;
-        player.hasPowerUp = false;
-        player.powerUpTimer = 0.f;
-        pBullets.clear();
-        powerUps.clear();
-        for (auto& b : eBullets) b.active = false;
-        // Return all diving enemies to formation
-        for (auto& e : enemies)
-            if (e.alive && (e.state == EnemyState::DIVING || e.state == EnemyState::RETURNING))
-                e.state = EnemyState::IN_FORMATION;
-        state      = GameState::PLAYER_DEAD;
-        stateTimer = 2.f;
+// ─────────────────────────────────────────────────────────────
+//  INPUT / HEADLESS RUNS
+// ─────────────────────────────────────────────────────────────
+static InputFrame readInput() {
+    InputFrame in;
+    in.left  = IsKeyDown(KEY_LEFT)  || IsKeyDown(KEY_A);
+    in.right = IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D);
+    in.fire  = IsKeyPressed(KEY_SPACE);
+    in.start = IsKeyPressed(KEY_ENTER) || IsKeyPressed(KEY_SPACE);
+    return in;
+}
+
+// Dos puestos en un teclado (cooperativo local): 1P con A/D + ESPACIO,
+// 2P con flechas + CTRL derecho. ENTER empieza la partida en ambos.
+static InputFrame readSeatInput(int seat) {
+    InputFrame in;
+    in.left  = IsKeyDown(seat == 0 ? KEY_A : KEY_LEFT);
+    in.right = IsKeyDown(seat == 0 ? KEY_D : KEY_RIGHT);
+    in.fire  = IsKeyPressed(seat == 0 ? KEY_SPACE : KEY_RIGHT_CONTROL);
+    in.start = IsKeyPressed(KEY_ENTER) || in.fire;
+    return in;
+}
+
+// Piloto automático determinista para ejecuciones sin ventana: se coloca
+// bajo el enemigo vivo más cercano (o el boss) y dispara en cuanto puede.
+static InputFrame autopilotInput(const Game& g, unsigned tick) {
+    InputFrame in;
+    if (g.state == GameState::ATTRACT) {
+        in.start = (tick % 30) == 0;
+        return in;
     }
+    if (g.state != GameState::PLAYING) return in;
 
-    int pointsForEnemy(EnemyType t, bool diving) {
-        int base = 0;
-        switch (t) {
-            case EnemyType::FLAGSHIP:   base = diving ? 400 : 150; break;
-            case EnemyType::ESCORT:     base = diving ? 160 :  40; break;
-            case EnemyType::ZAKO_BLUE:  base = diving ? 100 :  30; break;
-            case EnemyType::ZAKO_BLUE2: base = diving ?  80 :  20; break;
-            case EnemyType::ZAKO_GREEN: base = diving ?  60 :  10; break;
+    float targetX = g.player.x;
+    if (g.boss.active) {
+        targetX = g.boss.x;
+    } else {
+        float best = 1e9f;
+        // By id: ties go to the same enemy whatever the partition order
+        const EnemyStore& es = g.enemies;
+        for (int k = 0; k < es.count; ++k) {
+            int i = es.pos[k];
+            if (!es.isAlive(i)) continue;
+            float d = std::fabs(es.x[i] - g.player.x);
+            if (d < best) { best = d; targetX = es.x[i]; }
         }
-        return base;
     }
+    if (targetX < g.player.x - 6.f) in.left  = true;
+    if (targetX > g.player.x + 6.f) in.right = true;
+    in.fire = (tick % 8) == 0;
+    return in;
+}
 
-    // ── draw ──────────────────────────────────────────────────
-    void draw() {
-        ClearBackground(BLACK);
-        stars.draw();
+enum class InputPolicy { AUTOPILOT, RANDOM, IDLE };
 
-        switch (state) {
-            case GameState::ATTRACT:       drawAttract();     break;
-            case GameState::PLAYING:       drawPlaying();     break;
-            case GameState::PLAYER_DEAD:   drawDead();        break;
-            case GameState::GAME_OVER:     drawGameOver();    break;
-            case GameState::STAGE_CLEAR:   drawClear();       break;
+static bool parsePolicy(const char* name, InputPolicy& out) {
+    if (std::strcmp(name, "autopilot") == 0 || std::strcmp(name, "scripted") == 0) out = InputPolicy::AUTOPILOT;
+    else if (std::strcmp(name, "random") == 0) out = InputPolicy::RANDOM;
+    else if (std::strcmp(name, "idle") == 0)   out = InputPolicy::IDLE;
+    else return false;
+    return true;
+}
+
+// Input source for runs without a human. RANDOM holds a direction for a
+// random stretch and fires at random, from its own stream of the run seed.
+struct PolicyDriver {
+    InputPolicy policy = InputPolicy::AUTOPILOT;
+    RngStream   rng;
+    int         dir  = 0;
+    int         hold = 0;
+
+    void start(InputPolicy p, uint64_t seed) {
+        policy = p;
+        rng    = {GameRng::streamKey(seed, GameRng::POLICY), 0};
+        dir    = 0;
+        hold   = 0;
+    }
+
+    InputFrame next(const Game& g, unsigned tick) {
+        InputFrame in;
+        switch (policy) {
+            case InputPolicy::AUTOPILOT:
+                return autopilotInput(g, tick);
+            case InputPolicy::IDLE:
+                in.start = g.state == GameState::ATTRACT && (tick % 30) == 0;
+                return in;
+            case InputPolicy::RANDOM:
+                if (g.state == GameState::ATTRACT) {
+                    in.start = (tick % 30) == 0;
+                    return in;
+                }
+                if (--hold <= 0) {
+                    dir  = rng.range(-1, 1);
+                    hold = rng.range(6, 60);
+                }
+                in.left  = dir < 0;
+                in.right = dir > 0;
+                in.fire  = rng.range(0, 5) == 0;
+                return in;
         }
-        drawParticles();
+        return in;
+    }
+};
+
+static const char* stateName(GameState s) {
+    switch (s) {
+        case GameState::ATTRACT:     return "ATTRACT";
+        case GameState::PLAYING:     return "PLAYING";
+        case GameState::PLAYER_DEAD: return "PLAYER_DEAD";
+        case GameState::GAME_OVER:   return "GAME_OVER";
+        case GameState::STAGE_CLEAR: return "STAGE_CLEAR";
     }
+    return "?";
+}
 
-    void drawHUD() {
-        // Score top left
-        DrawText(TextFormat("%06d", score), 10, 10, 20, WHITE);
+struct RunOptions {
+    bool     headless = false;
+    long     frames   = 7200;          // ticks to simulate in headless mode
+    int      simHz    = SIM_HZ_DEFAULT;
+    bool     hasSeed  = false;
+    uint64_t seed     = 0;
+    const char* recordPath = nullptr;  // write an input log of this session
+    const char* replayPath = nullptr;  // verify an input log, then exit
+    int         startRound = 0;        // >0: start playing directly at this round
+    const char* loadStatePath = nullptr;
+    const char* saveStatePath = nullptr;
+    const char* hashTracePath = nullptr;  // per-tick hash log
+    const char* shotsDir  = nullptr;      // software-rendered PNGs (headless)
+    int         shotEvery = 120;          // ticks between shots
+    InputPolicy policy = InputPolicy::AUTOPILOT;
+    GameTuning  tuning;
+
+    // Co-op
+    bool        coop      = false;    // second ship
+    int         udpLocal  = 0;        // >0: rollback netplay over UDP loopback
+    int         udpRemote = 0;
+    int         coopSlot  = 0;        // ship this process drives online (0 or 1)
+    bool        coopSim   = false;    // two rollback peers over a simulated link
+    int         netLatency = 6;       // --coop-sim link, in ticks
+    int         netJitter  = 2;
+    int         netLoss    = 5;       // percent
+
+    long        collisionCases = 0;   // --check-collision: narrowphase self-check
+    long        replayChecks   = 0;   // --check-replay: record/replay round trip, ticks per run
+    int         stressLevels  = 0;    // --stress: load ramp steps (0 = off)
+    int         stressEnemies = 4096; // counts at the last step
+    int         stressBullets = 32768;
+    int         stressFx      = 8;    // explosions spawned per tick
+    int         stressFxCap   = 32768; // particle pool (flashes and debris scale with it)
+
+    // --batch
+    bool        batch     = false;
+    uint64_t    seedFirst = 1;
+    uint64_t    seedLast  = 1000;
+    int         maxRound  = 0;        // 0 = no cap
+    long        maxTicks  = 0;        // 0 = one hour of simulated time
+    int         threads   = 0;        // 0 = all cores
+    const char* csvPath   = "batch.csv";
+
+    // Replays store the seed and tuning; anything else needs a snapshot
+    bool startsFromBoot() const { return startRound <= 0 && !loadStatePath; }
+
+    uint64_t resolveSeed() const { return hasSeed ? seed : (uint64_t)time(nullptr); }
+};
 
-        // High score centered
-        DrawText("HIGH SCORE", SW/2 - 50, 8, 14, WHITE);
-        DrawText(TextFormat("%06d", highScore), SW/2 - 30, 22, 14, WHITE);
-        if (player.hasPowerUp) {
-            // Barra de tiempo restante
-            float ratio = (player.powerUpMaxDuration > 0.f)
-                ? player.powerUpTimer / player.powerUpMaxDuration : 0.f;
-            Color barCol = (ratio > 0.35f) ? Color{120, 255, 120, 255} : Color{255, 160, 40, 255};
-            DrawText(TextFormat("SHOT x%d", player.shotLevel), 10, 34, 14, barCol);
-            DrawRectangle(10, 52, 60, 5, {60, 60, 60, 200});
-            DrawRectangle(10, 52, (int)(60.f * ratio), 5, barCol);
+static bool parseArgs(int argc, char** argv, RunOptions& opt) {
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (std::strcmp(a, "--headless") == 0) {
+            opt.headless = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') opt.frames = std::atol(argv[++i]);
+        } else if (std::strcmp(a, "--sim-hz") == 0 && i + 1 < argc) {
+            opt.simHz = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(a, "--seed") == 0 && i + 1 < argc) {
+            opt.seed    = std::strtoull(argv[++i], nullptr, 0);
+            opt.hasSeed = true;
+        } else if (std::strcmp(a, "--record") == 0 && i + 1 < argc) {
+            opt.recordPath = argv[++i];
+        } else if (std::strcmp(a, "--replay") == 0 && i + 1 < argc) {
+            opt.replayPath = argv[++i];
+        } else if (std::strcmp(a, "--round") == 0 && i + 1 < argc) {
+            opt.startRound = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(a, "--load-state") == 0 && i + 1 < argc) {
+            opt.loadStatePath = argv[++i];
+        } else if (std::strcmp(a, "--save-state") == 0 && i + 1 < argc) {
+            opt.saveStatePath = argv[++i];
+        } else if (std::strcmp(a, "--hash-trace") == 0 && i + 1 < argc) {
+            opt.hashTracePath = argv[++i];
+        } else if (std::strcmp(a, "--coop") == 0) {
+            opt.coop = true;
+        } else if (std::strcmp(a, "--coop-udp") == 0 && i + 1 < argc) {
+            char* end = nullptr;
+            opt.udpLocal  = (int)std::strtol(argv[++i], &end, 10);
+            opt.udpRemote = (*end == ':') ? (int)std::strtol(end + 1, nullptr, 10) : 0;
+            if (opt.udpLocal <= 0 || opt.udpRemote <= 0) {
+                std::fprintf(stderr, "--coop-udp expects LOCAL_PORT:REMOTE_PORT\n");
+                return false;
+            }
+            opt.coop = true;
+        } else if (std::strcmp(a, "--coop-player") == 0 && i + 1 < argc) {
+            opt.coopSlot = std::atoi(argv[++i]) == 2 ? 1 : 0;
+        } else if (std::strcmp(a, "--check-collision") == 0) {
+            opt.collisionCases = 1000000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') opt.collisionCases = std::max(1L, std::atol(argv[++i]));
+        } else if (std::strcmp(a, "--check-replay") == 0) {
+            opt.replayChecks = 6000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') opt.replayChecks = std::max(1L, std::atol(argv[++i]));
+        } else if (std::strcmp(a, "--stress") == 0) {
+            opt.stressLevels = 8;
+            if (i + 1 < argc && argv[i + 1][0] != '-') opt.stressLevels = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(a, "--stress-enemies") == 0 && i + 1 < argc) {
+            opt.stressEnemies = std::clamp(std::atoi(argv[++i]), 1, ENEMY_CAPACITY);
+        } else if (std::strcmp(a, "--stress-bullets") == 0 && i + 1 < argc) {
+            opt.stressBullets = std::clamp(std::atoi(argv[++i]), 1, POOL_MAX_CAPACITY);
+        } else if (std::strcmp(a, "--stress-fx") == 0 && i + 1 < argc) {
+            opt.stressFx = std::max(0, std::atoi(argv[++i]));
+        } else if (std::strcmp(a, "--stress-fx-cap") == 0 && i + 1 < argc) {
+            opt.stressFxCap = std::clamp(std::atoi(argv[++i]), FX_MAX_PARTICLES, 1 << 20);
+        } else if (std::strcmp(a, "--coop-sim") == 0) {
+            opt.coopSim = true;
+            opt.coop    = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') opt.frames = std::atol(argv[++i]);
+        } else if (std::strcmp(a, "--net-latency") == 0 && i + 1 < argc) {
+            opt.netLatency = std::max(0, std::atoi(argv[++i]));
+        } else if (std::strcmp(a, "--net-jitter") == 0 && i + 1 < argc) {
+            opt.netJitter = std::max(0, std::atoi(argv[++i]));
+        } else if (std::strcmp(a, "--net-loss") == 0 && i + 1 < argc) {
+            opt.netLoss = std::clamp(std::atoi(argv[++i]), 0, 100);
+        } else if (std::strcmp(a, "--shots") == 0 && i + 1 < argc) {
+            opt.shotsDir = argv[++i];
+        } else if (std::strcmp(a, "--shot-every") == 0 && i + 1 < argc) {
+            opt.shotEvery = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(a, "--policy") == 0 && i + 1 < argc) {
+            if (!parsePolicy(argv[++i], opt.policy)) {
+                std::fprintf(stderr, "Unknown policy: %s (autopilot|random|idle)\n", argv[i]);
+                return false;
+            }
+        } else if (std::strcmp(a, "--dive-interval") == 0 && i + 1 < argc) {
+            opt.tuning.diveInterval = (float)std::atof(argv[++i]);
+        } else if (std::strcmp(a, "--speed-scale") == 0 && i + 1 < argc) {
+            opt.tuning.speedScale = (float)std::atof(argv[++i]);
+        } else if (std::strcmp(a, "--boss-hp-scale") == 0 && i + 1 < argc) {
+            opt.tuning.bossHpScale = (float)std::atof(argv[++i]);
+        } else if (std::strcmp(a, "--bullet-cap") == 0 && i + 1 < argc) {
+            opt.tuning.enemyBulletCap = std::clamp(std::atoi(argv[++i]), 1, POOL_MAX_CAPACITY);
+        } else if (std::strcmp(a, "--formation") == 0 && i + 1 < argc) {
+            // COLSxROWS, clamped to 64 x 64 by layoutFormation()
+            char* end = nullptr;
+            opt.tuning.formCols = (int)std::strtol(argv[++i], &end, 10);
+            opt.tuning.formRows = (*end == 'x') ? std::atoi(end + 1) : opt.tuning.formRows;
+        } else if (std::strcmp(a, "--batch") == 0) {
+            opt.batch = true;
+        } else if (std::strcmp(a, "--seeds") == 0 && i + 1 < argc) {
+            char* end = nullptr;
+            opt.seedFirst = std::strtoull(argv[++i], &end, 0);
+            opt.seedLast  = (*end == ':') ? std::strtoull(end + 1, nullptr, 0) : opt.seedFirst;
+            if (opt.seedLast < opt.seedFirst) std::swap(opt.seedFirst, opt.seedLast);
+        } else if (std::strcmp(a, "--max-round") == 0 && i + 1 < argc) {
+            opt.maxRound = std::max(0, std::atoi(argv[++i]));
+        } else if (std::strcmp(a, "--max-ticks") == 0 && i + 1 < argc) {
+            opt.maxTicks = std::max(0L, std::atol(argv[++i]));
+        } else if (std::strcmp(a, "--threads") == 0 && i + 1 < argc) {
+            opt.threads = std::max(0, std::atoi(argv[++i]));
+        } else if (std::strcmp(a, "--csv") == 0 && i + 1 < argc) {
+            opt.csvPath = argv[++i];
         } else {
-            DrawText("SHOT x1", 10, 34, 14, {160, 160, 160, 200});
+            std::fprintf(stderr,
+                "Unknown option: %s\n"
+                "Usage: %s [--headless [ticks]] [--sim-hz N] [--seed N]\n"
+                "          [--record file.gxr] [--replay file.gxr]\n"
+                "          [--round N] [--load-state file.gxs] [--save-state file.gxs]\n"
+                "          [--hash-trace file.txt] [--policy autopilot|random|idle]\n"
+                "          [--shots dir [--shot-every N]]\n"
+                "          [--coop] [--coop-udp LOCAL:REMOTE [--coop-player 1|2]]\n"
+                "          [--coop-sim [ticks] [--net-latency T] [--net-jitter T] [--net-loss PCT]]\n"
+                "          [--check-collision [cases]] [--check-replay [ticks]]\n"
+                "          [--stress [levels] [--stress-enemies N] [--stress-bullets N]\n"
+                "                    [--stress-fx N] [--stress-fx-cap N]]\n"
+                "          [--dive-interval S] [--speed-scale X] [--boss-hp-scale X] [--bullet-cap N]\n"
+                "          [--formation COLSxROWS]\n"
+                "          [--batch [--seeds A:B] [--max-round N] [--max-ticks N]\n"
+                "                   [--threads N] [--csv file.csv]]\n", a, argv[0]);
+            return false;
         }
+    }
+    if (opt.coop && opt.recordPath) {
+        std::fprintf(stderr, "--record only logs player 1 and cannot be combined with co-op\n");
+        return false;
+    }
+#if !GX_HAS_UDP
+    if (opt.udpLocal > 0) {
+        std::fprintf(stderr, "--coop-udp is not available on this platform\n");
+        return false;
+    }
+#endif
+    return true;
+}
 
-        // Lives (bottom left as ship icons)
-        for (int i = 0; i < player.lives; ++i) {
-            drawTextureCentered(gSprites.playerLife, 20.f + i * 28.f, SH - 18.f, LIFE_ICON_SIZE);
-        }
+static bool openTrace(HashTrace& trace, const RunOptions& opt) {
+    if (!opt.hashTracePath || trace.open(opt.hashTracePath)) return true;
+    std::fprintf(stderr, "could not open hash trace %s\n", opt.hashTracePath);
+    return false;
+}
 
-        // Round flags (bottom right)
-        for (int i = 0; i < round && i < 8; ++i) {
-            Color fc = {(unsigned char)(100 + i*20), 80, 200, 255};
-            DrawRectangle(SW - 20 - i*16, SH - 26, 12, 16, fc);
+// Boot from the seed, then apply --round / --load-state.
+static bool setupGame(Game& game, const RunOptions& opt, uint64_t seed) {
+    game.tuning = opt.tuning;
+    game.coop   = opt.coop;
+    game.boot(seed);
+    if (opt.startRound > 0) game.startAtRound(opt.startRound);
+    if (opt.loadStatePath) {
+        std::vector<uint8_t> buf;
+        if (!readFile(opt.loadStatePath, buf) || !game.loadState(buf)) {
+            std::fprintf(stderr, "could not load snapshot %s\n", opt.loadStatePath);
+            return false;
         }
     }
+    return true;
+}
 
-    void drawEnemies() {
-        if (boss.active) {
-            {
-                Texture2D& bossTex = (boss.type == EnemyType::FLAGSHIP)
-                    ? gSprites.enemy1Anim[(gEnemyAnimFrame) % 3]
-                    : (boss.type == EnemyType::ZAKO_BLUE
-                        ? gSprites.enemy2Anim[ENEMY2_PINGPONG[(int)(gEnemy2Time * 4.0f) % 10]]
-                        : gSprites.enemy3Anim[ENEMY3_PINGPONG[(int)(gEnemy3Time * 4.0f) % 4]]);
-                drawTextureCentered(bossTex, boss.x, boss.y, boss.size);
-            }
+static double elapsedUs(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+}
 
-            float bw = 180.f;
-            float bh = 8.f;
-            float bx = SW * 0.5f - bw * 0.5f;
-            float by = 52.f;
-            float pct = (boss.maxHp > 0) ? (float)boss.hp / (float)boss.maxHp : 0.f;
-            DrawRectangle((int)bx, (int)by, (int)bw, (int)bh, {70, 70, 70, 220});
-            DrawRectangle((int)bx, (int)by, (int)(bw * std::clamp(pct, 0.f, 1.f)), (int)bh, {255, 90, 90, 255});
-            DrawText("BOSS", (int)bx, (int)by - 14, 12, {255, 180, 180, 255});
-        }
-
-        for (const auto& e : enemies) {
-            if (!e.alive) continue;
-            float rot = enemyBaseRotation(e.type);
-            if (e.state == EnemyState::DIVING) {
-                float dx = player.x - e.x;
-                float dy = player.y - e.y;
-                // 0 deg points "down" in this sprite set; add base per enemy art orientation.
-                float aimDeg = std::atan2(dy, dx) * RAD2DEG - 90.f;
-                rot += aimDeg;
+// Steps the simulation with no window and no GL context.
+static int runHeadless(const RunOptions& opt) {
+    uint64_t seed = opt.resolveSeed();
+    Game game;
+    if (!setupGame(game, opt, seed)) return 1;
+
+    Replay rec;
+    rec.start(seed, opt.simHz, game.tuning, opt.startsFromBoot() ? nullptr : &game);
+    HashTrace trace;
+    if (!openTrace(trace, opt)) return 1;
+    PolicyDriver policy;
+    policy.start(opt.policy, seed);
+
+    SoftCanvas canvas;
+    long   shots = 0;
+    double shotUs = 0.0;   // render time only, excludes PNG encoding
+
+    const float dt = 1.f / opt.simHz;
+    auto t0 = std::chrono::steady_clock::now();
+    for (long f = 0; f < opt.frames; ++f) {
+        InputFrame in = policy.next(game, (unsigned)f);
+        game.update(dt, in);
+        if (opt.recordPath) rec.record(in, game);
+        trace.write(game);
+        if (opt.shotsDir && (f + 1) % opt.shotEvery == 0) {
+            auto tr = std::chrono::steady_clock::now();
+            renderSoft(game, canvas);
+            shotUs += elapsedUs(tr);
+            ++shots;
+            char path[1024];
+            std::snprintf(path, sizeof path, "%s/shot_%06ld.png", opt.shotsDir, f + 1);
+            Image img = {canvas.px.data(), SW, SH, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+            if (!ExportImage(img, path)) {
+                std::fprintf(stderr, "headless: could not write %s\n", path);
+                return 1;
             }
-            drawEnemy(e.type, e.x, e.y, rot, e.col);
         }
     }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
 
-    void drawBullets() {
-        BeginBlendMode(BLEND_ADDITIVE);
+    if (opt.recordPath && !rec.save(opt.recordPath)) {
+        std::fprintf(stderr, "headless: could not write replay %s\n", opt.recordPath);
+        return 1;
+    }
 
-        // Player bullets – bright yellow/white core with soft glow
-        for (const auto& b : pBullets) {
-            if (!b.active) continue;
-            // Outer glow
-            DrawCircleGradient((int)b.x, (int)(b.y - BULLET_H * 0.3f),
-                BULLET_W * 3.f, {255, 255, 180, 70}, {255, 255, 80, 0});
-            // Core gradient (bright white tip → yellow base)
-            DrawRectangleGradientV(
-                (int)(b.x - BULLET_W/2), (int)(b.y - BULLET_H/2),
-                (int)BULLET_W, (int)BULLET_H,
-                {255, 255, 255, 255}, {255, 210, 30, 200});
+    // Snapshot cost on the final state (averaged; buffer reused like a save slot)
+    std::vector<uint8_t> snap;
+    Game probe;
+    const int reps = 200;
+    auto ts = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; ++i) game.saveState(snap);
+    double saveUs = elapsedUs(ts) / reps;
+    ts = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; ++i) probe.loadState(snap);
+    double loadUs = elapsedUs(ts) / reps;
+    if (probe.tickHash != game.tickHash || probe.checksum() != game.checksum()) {
+        std::fprintf(stderr, "headless: snapshot round-trip mismatch\n");
+        return 1;
+    }
+    if (opt.saveStatePath && !writeFile(opt.saveStatePath, snap)) {
+        std::fprintf(stderr, "headless: could not write snapshot %s\n", opt.saveStatePath);
+        return 1;
+    }
+
+    std::printf("headless: seed=%llu ticks=%ld sim_hz=%d time=%.3fs (%.0f ticks/s) state=%s score=%d high=%d round=%d lives=%d hash=%016llx\n",
+        (unsigned long long)seed, opt.frames, opt.simHz, secs, secs > 0.0 ? opt.frames / secs : 0.0, stateName(game.state),
+        game.score, game.highScore, game.round, game.player.lives, (unsigned long long)game.tickHash);
+    std::printf("snapshot: bytes=%zu save=%.2fus restore=%.2fus\n", snap.size(), saveUs, loadUs);
+    uint32_t dropped = game.fx.overflow + game.pBullets.overflow + game.eBullets.overflow + game.powerUps.overflow;
+    if (dropped > 0)
+        std::printf("overflow: fx=%u player_bullets=%u enemy_bullets=%u power_ups=%u\n", game.fx.overflow,
+            game.pBullets.overflow, game.eBullets.overflow, game.powerUps.overflow);
+    if (shots > 0)
+        std::printf("shots: %ld frames in %s, software render avg=%.1fus\n", shots, opt.shotsDir, shotUs / shots);
+    return 0;
+}
+
+// Boots game the way rp was recorded (seed, tuning, initial snapshot).
+static bool startReplay(Game& game, const Replay& rp) {
+    game.tuning = rp.tuning;
+    game.boot(rp.seed);
+    return rp.initialState.empty() || game.loadState(rp.initialState);
+}
+
+// Feeds rp's inputs to game, checking every stored checksum. Prints the
+// first divergence (prefixed with tag) and returns false on it.
+static bool playReplay(Game& game, const Replay& rp, HashTrace& trace, const char* tag,
+                       uint32_t& tick, size_t& check) {
+    const float dt = 1.f / rp.simHz;
+    tick  = 0;
+    check = 0;
+    for (size_t run = 0; run < rp.runInput.size(); ++run) {
+        InputFrame in = unpackInput(rp.runInput[run]);
+        for (uint32_t n = 0; n < rp.runLength[run]; ++n) {
+            game.update(dt, in);
+            trace.write(game);
+            ++tick;
+            if (tick % rp.checkInterval == 0 && check < rp.checksums.size()) {
+                uint64_t got = game.tickHash;
+                if (got != rp.checksums[check]) {
+                    std::printf("%s: DESYNC at tick %u (checkpoint %zu): expected %016llx got %016llx\n",
+                        tag, tick, check, (unsigned long long)rp.checksums[check], (unsigned long long)got);
+                    return false;
+                }
+                ++check;
+            }
         }
+    }
+    if (game.tickHash != rp.finalChecksum) {
+        std::printf("%s: DESYNC at final tick %u\n", tag, tick);
+        return false;
+    }
+    return true;
+}
 
-        // Enemy bullets – red/orange glow
-        for (const auto& b : eBullets) {
-            if (!b.active) continue;
-            // Outer glow
-            DrawCircleGradient((int)b.x, (int)(b.y + EBULLET_H * 0.3f),
-                EBULLET_W * 3.f, {255, 60, 0, 80}, {255, 30, 0, 0});
-            // Core gradient (orange tip → red base)
-            DrawRectangleGradientV(
-                (int)(b.x - EBULLET_W/2), (int)(b.y - EBULLET_H/2),
-                (int)EBULLET_W, (int)EBULLET_H,
-                {255, 180, 40, 200}, {255, 30, 0, 255});
+// Plays an input log back as fast as possible (no window) and checks every
+// stored checksum. Returns non-zero at the first divergence.
+static int runReplay(const RunOptions& opt) {
+    Replay rp;
+    if (!rp.load(opt.replayPath)) {
+        std::fprintf(stderr, "replay: %s is not a valid replay (v%u)\n", opt.replayPath, REPLAY_VERSION);
+        return 1;
+    }
+
+    Game game;
+    if (!startReplay(game, rp)) {
+        std::fprintf(stderr, "replay: initial snapshot in %s does not match this build\n", opt.replayPath);
+        return 1;
+    }
+    HashTrace trace;
+    if (!openTrace(trace, opt)) return 1;
+
+    uint32_t tick = 0;
+    size_t   check = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = playReplay(game, rp, trace, "replay", tick, check);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (!ok) return 1;
+    std::printf("replay: OK seed=%llu ticks=%u sim_hz=%u checkpoints=%zu time=%.3fs (%.0f ticks/s) score=%d round=%d hash=%016llx\n",
+        (unsigned long long)rp.seed, tick, rp.simHz, check, secs, secs > 0.0 ? tick / secs : 0.0,
+        game.score, game.round, (unsigned long long)game.tickHash);
+    return 0;
+}
+
+// Records the autopilot under a few tunings, pushes each log through
+// encode/decode and replays it from the decoded header alone, so any
+// tuning that changes the boot but is not stored shows up as a desync.
+static int runReplayCheck(const RunOptions& opt) {
+    struct Case { const char* name; GameTuning tuning; };
+    std::vector<Case> cases(2);
+    cases[0].name = "default";
+    cases[1].name = "tuned";
+    cases[1].tuning.diveInterval = 0.8f;
+    cases[1].tuning.speedScale   = 1.3f;
+    cases[1].tuning.bossHpScale  = 2.f;
+    cases[1].tuning.enemyBulletCap = 4;
+    cases[1].tuning.formCols = 16;
+    cases[1].tuning.formRows = 6;
+
+    const uint64_t seed = opt.hasSeed ? opt.seed : 9;
+    int failures = 0;
+    for (const Case& c : cases) {
+        Game game;
+        game.tuning = c.tuning;
+        game.boot(seed);
+        Replay rec;
+        rec.start(seed, opt.simHz, game.tuning);
+        PolicyDriver policy;
+        policy.start(InputPolicy::AUTOPILOT, seed);
+        const float dt = 1.f / opt.simHz;
+        for (long f = 0; f < opt.replayChecks; ++f) {
+            InputFrame in = policy.next(game, (unsigned)f);
+            game.update(dt, in);
+            rec.record(in, game);
         }
 
-        EndBlendMode();
+        std::vector<uint8_t> data;
+        rec.encode(data);
+        Replay rp;
+        Game replay;
+        HashTrace trace;
+        uint32_t tick = 0;
+        size_t   check = 0;
+        bool ok = rp.decode(data) && startReplay(replay, rp)
+               && playReplay(replay, rp, trace, "check-replay", tick, check);
+        std::printf("check-replay: %-8s %s ticks=%u checkpoints=%zu bytes=%zu hash=%016llx\n",
+            c.name, ok ? "OK" : "FAIL", tick, check, data.size(), (unsigned long long)game.tickHash);
+        if (!ok) ++failures;
     }
+    return failures ? 1 : 0;
+}
 
-    void drawPowerUps() {
-        for (const auto& p : powerUps) {
-            if (!p.active) continue;
-            Color c = {120, 220, 255, 255};
-            const char* label = "F";
-            if (p.type == PowerUpType::DOUBLE_SHOT) { c = {255, 220, 120, 255}; label = "2"; }
-            if (p.type == PowerUpType::TRIPLE_SHOT) { c = {255, 140, 120, 255}; label = "3"; }
-            DrawCircle((int)p.x, (int)p.y, 8.f, c);
-            DrawText(label, (int)p.x - 4, (int)p.y - 6, 12, BLACK);
+// Two rollback peers in one process over a SimChannel (or real UDP sockets
+// on loopback with --coop-udp). Checks that both end on the same state, and
+// that it matches a plain run of the same inputs.
+static int runCoopSim(const RunOptions& opt) {
+    uint64_t seed = opt.hasSeed ? opt.seed : 1;
+    const long target = opt.frames;
+
+    Game games[2];
+    for (auto& g : games)
+        if (!setupGame(g, opt, seed)) return 1;
+
+    SimChannel ch;
+    ch.latency = opt.netLatency;
+    ch.jitter  = opt.netJitter;
+    ch.lossPct = opt.netLoss;
+    ch.start(seed);
+    SimEndpoint ends[2];
+    NetTransport* links[2] = {&ends[0], &ends[1]};
+#if GX_HAS_UDP
+    UdpTransport udp[2];
+    if (opt.udpLocal > 0) {
+        if (!udp[0].open(opt.udpLocal, opt.udpRemote) || !udp[1].open(opt.udpRemote, opt.udpLocal)) {
+            std::fprintf(stderr, "coop-sim: could not bind UDP ports %d/%d\n", opt.udpLocal, opt.udpRemote);
+            return 1;
         }
+        links[0] = &udp[0];
+        links[1] = &udp[1];
+    }
+#endif
+    RollbackSession peers[2];
+    PolicyDriver drivers[2];
+    std::vector<uint8_t> played[2];   // each seat's input per tick, for the reference run
+    for (int i = 0; i < 2; ++i) {
+        ends[i].ch   = &ch;
+        ends[i].side = i;
+        peers[i].start(games[i], *links[i], i, opt.simHz);
+        drivers[i].start(i == 0 ? opt.policy : InputPolicy::RANDOM, seed + (uint64_t)i);
+        played[i].reserve((size_t)target);
     }
 
-    void drawPlaying() {
-        drawEnemies();
-        drawBullets();
-        drawPowerUps();
+    auto t0 = std::chrono::steady_clock::now();
+    long frames = 0;
+    const long frameCap = target * 8 + 1000;
+    while ((peers[0].tick < target || peers[1].tick < target) && frames < frameCap) {
+        ++ch.now;
+        ++frames;
+        for (int i = 0; i < 2; ++i) {
+            RollbackSession& p = peers[i];
+            if (p.tick >= target) { p.pump(); continue; }
+            // Seat 2 plays the random policy (autopilot only steers player 1)
+            InputFrame in = drivers[i].next(games[i], p.tick);
+            if (p.advance(in)) played[i].push_back(packInput(in));
+        }
+    }
+    // Drain: deliver everything still in flight so both peers confirm every tick
+    for (int n = 0; n < opt.netLatency + opt.netJitter + 64 &&
+         (peers[0].syncTick < target || peers[1].syncTick < target); ++n) {
+        ++ch.now;
+        peers[0].pump();
+        peers[1].pump();
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    Game ref;
+    setupGame(ref, opt, seed);
+    const float dt = 1.f / opt.simHz;
+    long refTicks = std::min(played[0].size(), played[1].size());
+    for (long t = 0; t < refTicks; ++t)
+        ref.update(dt, unpackInput(played[0][t]), unpackInput(played[1][t]));
+
+    bool synced = peers[0].syncTick == target && peers[1].syncTick == target &&
+                  peers[0].syncHash == peers[1].syncHash &&
+                  games[0].tickHash == games[1].tickHash && refTicks == target &&
+                  ref.tickHash == games[0].tickHash;
+    uint32_t rollbacks = peers[0].rollbacks + peers[1].rollbacks;
+    uint32_t resim     = peers[0].resimTicks + peers[1].resimTicks;
+    double   rbUs      = peers[0].rollbackUs + peers[1].rollbackUs;
+    if (opt.udpLocal > 0)
+        std::printf("coop-sim: %s seed=%llu ticks=%ld frames=%ld link=udp 127.0.0.1:%d<->%d time=%.3fs\n",
+            synced ? "OK" : "DESYNC", (unsigned long long)seed, target, frames, opt.udpLocal, opt.udpRemote, secs);
+    else
+        std::printf("coop-sim: %s seed=%llu ticks=%ld frames=%ld link=%d+-%d ticks loss=%d%% (%llu/%llu dropped) time=%.3fs\n",
+            synced ? "OK" : "DESYNC", (unsigned long long)seed, target, frames, ch.latency, ch.jitter, ch.lossPct,
+            (unsigned long long)ch.dropped, (unsigned long long)ch.sent, secs);
+    std::printf("coop-sim: rollbacks=%u resim_ticks=%u max_depth=%u/%u avg_rollback=%.1fus stalls=%u/%u desyncs=%u/%u\n",
+        rollbacks, resim, std::max(peers[0].maxRollback, peers[1].maxRollback), (unsigned)NET_MAX_ROLLBACK,
+        rollbacks ? rbUs / rollbacks : 0.0, peers[0].stalls, peers[1].stalls, peers[0].desyncs, peers[1].desyncs);
+    std::printf("coop-sim: state=%s score=%d round=%d lives=%d/%d hash=%016llx ref=%016llx\n",
+        stateName(games[0].state), games[0].score, games[0].round, games[0].player.lives, games[0].player2.lives,
+        (unsigned long long)games[0].tickHash, (unsigned long long)ref.tickHash);
+    return synced ? 0 : 1;
+}
 
-        // Player (blinks when invincible)
-        bool showPlayer = player.alive &&
-            (!player.invincible || (int)(player.invTimer * 10) % 2 == 0);
-        if (showPlayer)
-            drawPlayerShip(player.x, player.y, player.vx, player.thrusterTime);
+// Checks aabbMask (the SIMD path this build uses) and aabbMaskScalar against
+// CheckCollisionRecs on random batches. Coordinates are mostly snapped to
+// a coarse lattice so touching and coincident edges come up constantly.
+static int runCollisionCheck(const RunOptions& opt) {
+    RngStream rng{opt.hasSeed ? opt.seed : 1};
+    auto coord = [&](int lo, int hi) {
+        return rng.range(0, 3) == 0 ? rng.range(lo * 16, hi * 16) / 16.f : (float)(rng.range(lo, hi) * 4);
+    };
+    auto rect = [&]() -> Rectangle {
+        return {coord(-8, 128), coord(-8, 188), coord(0, 12), coord(0, 12)};   // width/height may be 0
+    };
 
-        drawHUD();
+    std::array<float, AABB_BATCH> minX, minY, maxX, maxY;
+    std::array<Rectangle, AABB_BATCH> boxes;
+    long mismatches = 0, hits = 0;
+    double simdUs = 0.0, scalarUs = 0.0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (long c = 0; c < opt.collisionCases; ++c) {
+        int n = rng.range(1, AABB_BATCH);
+        for (int i = 0; i < n; ++i) {
+            boxes[i] = rect();
+            minX[i] = boxes[i].x;                   minY[i] = boxes[i].y;
+            maxX[i] = boxes[i].x + boxes[i].width;  maxY[i] = boxes[i].y + boxes[i].height;
+        }
+        Rectangle q = rect();
+
+        uint32_t expect = 0;
+        for (int i = 0; i < n; ++i)
+            if (CheckCollisionRecs(q, boxes[i])) expect |= 1u << i;
+        auto ts = std::chrono::steady_clock::now();
+        uint32_t simd = aabbMask(q, minX.data(), minY.data(), maxX.data(), maxY.data(), n);
+        auto tm = std::chrono::steady_clock::now();
+        uint32_t scalar = aabbMaskScalar(q, minX.data(), minY.data(), maxX.data(), maxY.data(), n);
+        simdUs   += std::chrono::duration<double, std::micro>(tm - ts).count();
+        scalarUs += elapsedUs(tm);
+
+        for (uint32_t m = expect; m; m &= m - 1) ++hits;
+        if (simd != expect || scalar != expect) {
+            if (mismatches++ < 5)
+                std::fprintf(stderr, "check-collision: case %ld n=%d expect=%08x simd=%08x scalar=%08x\n",
+                    c, n, expect, simd, scalar);
+        }
     }
 
-    void drawDead() {
-        drawEnemies();
-        drawHUD();
+    // The grid with more entries than 16 bits index (enemies plus a full
+    // 1 << 16 bullet pool), every query checked against a linear scan
+    const int gridEntries = ENEMY_CAPACITY + POOL_MAX_CAPACITY + 64, gridQueries = 500;
+    long gridMismatches = 0, gridHits = 0;
+    {
+        CollisionGrid grid;
+        std::vector<Rectangle> rects(gridEntries);
+        for (int i = 0; i < gridEntries; ++i) {
+            rects[i] = rect();
+            grid.add(rects[i], (uint8_t)(1u << (i % 3)), i);
+        }
+        grid.build();
+        std::vector<int> got, want;
+        for (int c = 0; c < gridQueries; ++c) {
+            Rectangle q = rect();
+            uint32_t mask = (uint32_t)rng.range(1, 7);
+            got.clear();
+            want.clear();
+            grid.query(q, mask, [&](const CollisionGrid::Entry& e) { got.push_back((int)e.key); });
+            for (int i = 0; i < gridEntries; ++i)
+                if ((mask >> (i % 3) & 1) && CheckCollisionRecs(q, rects[i])) want.push_back(i);
+            std::sort(got.begin(), got.end());
+            gridHits += (long)want.size();
+            if (got != want && gridMismatches++ < 5)
+                std::fprintf(stderr, "check-collision: grid query %d expect=%zu hits got=%zu\n",
+                    c, want.size(), got.size());
+        }
     }
+    mismatches += gridMismatches;
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+#if defined(__AVX__)
+    const char* path = "avx";
+#elif GX_SOFT_SSE2
+    const char* path = "sse2";
+#else
+    const char* path = "scalar";
+#endif
+    std::printf("check-collision: %s cases=%ld hits=%ld mismatches=%ld path=%s time=%.2fs\n",
+        mismatches ? "FAIL" : "OK", opt.collisionCases, hits, mismatches, path, secs);
+    std::printf("check-collision: kernel=%.1fns scalar=%.1fns per batch (timer overhead included)\n",
+        simdUs * 1000.0 / opt.collisionCases, scalarUs * 1000.0 / opt.collisionCases);
+    std::printf("check-collision: grid entries=%d queries=%d hits=%ld mismatches=%ld\n",
+        gridEntries, gridQueries, gridHits, gridMismatches);
+    return mismatches ? 1 : 0;
+}
 
-    void drawGameOver() {
-        drawEnemies();
-        drawHUD();
-        int tw = MeasureText("GAME OVER", 40);
-        DrawText("GAME OVER", SW/2 - tw/2, SH/2 - 20, 40, RED);
+// Narrowphase sanity check for --stress: overlaps found through the game's
+// grid against a scalar pass over the entities themselves, for the ship,
+// every player bullet and random probes. Counts (kind, key) pairs; returns
+// how many probes disagree.
+static long stressGridCheck(Game& g, RngStream& rng, long& hits) {
+    g.buildCollisionGrid();
+    std::vector<Rectangle> probes;
+    probes.push_back(g.player.hitbox());
+    for (const Bullet& b : g.pBullets) probes.push_back(sweepBounds(g.bulletSweep(b)));
+    for (int n = 0; n < 256; ++n)
+        probes.push_back({(float)rng.range(-20, SW), (float)rng.range(-20, SH), (float)rng.range(1, 48), (float)rng.range(1, 48)});
+
+    const uint32_t all = GRID_ENEMY | GRID_BOSS | GRID_EBULLET | GRID_POWERUP;
+    std::vector<uint64_t> got, want;
+    long bad = 0;
+    for (const Rectangle& r : probes) {
+        got.clear();
+        want.clear();
+        g.grid.query(r, all, [&](const CollisionGrid::Entry& e) { got.push_back((uint64_t)e.kind << 32 | e.key); });
+        auto scan = [&](const Rectangle& box, uint8_t kind, int key) {
+            if (CheckCollisionRecs(r, box)) want.push_back((uint64_t)kind << 32 | (uint32_t)key);
+        };
+        for (int i = 0; i < g.enemies.alive; ++i) scan(sweepBounds(g.enemySweep(i)), GRID_ENEMY, g.enemies.id[i]);
+        if (g.boss.active) scan(sweepBounds(g.bossSweep()), GRID_BOSS, 0);
+        for (int i = 0; i < g.eBullets.size(); ++i) scan(sweepBounds(g.bulletSweep(g.eBullets[i])), GRID_EBULLET, i);
+        for (int i = 0; i < g.powerUps.size(); ++i) scan(g.powerUps[i].rect(), GRID_POWERUP, i);
+        std::sort(got.begin(), got.end());
+        std::sort(want.begin(), want.end());
+        hits += (long)want.size();
+        bad += got != want;
     }
+    return bad;
+}
 
-    void drawAttract() {
-        // Big title
-        int tw = MeasureText("GALAX IA", 48);
-        DrawText("GALAX IA", SW/2 - tw/2, 40, 48, {255, 220, 50, 255});
+// Load ramp for finding where each subsystem drops below 60 FPS. Step k of
+// N plays round 1 with k/N of the enemy, bullet and explosion counts: a
+// formation sized to hold the enemies, half of them kept diving
+// (launchDive), enemy bullets topped up with boss volleys fired from random
+// points (fireBossVolley) and explosions spawned every tick
+// (spawnExplosion) into pools grown to --stress-fx-cap particles, so the
+// explosions are simulated rather than dropped. Any level that still
+// overflows them is flagged, since its fx load is capped. The ship is
+// invincible so nothing clears the field. Render time is the software renderer's (renderSoft), the only one that
+// runs without a window. Each level ends with stressGridCheck; bullet and
+// enemy counts are clamped to the pools, so the grid stays within
+// GRID_MAX_ENTRIES.
+static int runStress(const RunOptions& opt) {
+    const float dt = 1.f / opt.simHz;
+    const int   warmup = 60, measure = 120;
+    const double budgetUs = 1e6 / 60.0;
+    SoftCanvas canvas;
+    RngStream  rng{opt.hasSeed ? opt.seed : 1};
+    int simFalls = 0, renderFalls = 0, frameFalls = 0;   // first level over budget
+    long gridBad = 0;
+    int  fxCapped = 0;          // first level whose explosions overflowed the pools
+    uint32_t fxDropped = 0;
+
+    std::printf("stress: %d levels up to enemies=%d bullets=%d fx=%d/tick (pool %d), %d ticks each at %d Hz\n",
+        opt.stressLevels, opt.stressEnemies, opt.stressBullets, opt.stressFx, opt.stressFxCap, measure, opt.simHz);
+    for (int level = 1; level <= opt.stressLevels; ++level) {
+        int enemies = std::max(1, opt.stressEnemies * level / opt.stressLevels);
+        int bullets = std::max(1, opt.stressBullets * level / opt.stressLevels);
+        int fxPerTick = opt.stressFx * level / opt.stressLevels;
+
+        Game game;
+        game.tuning = opt.tuning;
+        game.tuning.formCols = std::clamp((int)std::ceil(std::sqrt(enemies * 2.0)), 10, FORM_MAX_COLS);
+        game.tuning.formRows = std::clamp((enemies + 14 + game.tuning.formCols - 1) / game.tuning.formCols, 1, FORM_MAX_ROWS);
+        game.tuning.enemyBulletCap = bullets;
+        game.boot(opt.hasSeed ? opt.seed : 1);
+        game.startAtRound(1);
+        // Same 1024:64:256 proportions as the shipped FX_MAX_* pools
+        game.fx.reserve(opt.stressFxCap, opt.stressFxCap / 16, opt.stressFxCap / 4);
+        PolicyDriver policy;
+        policy.start(opt.policy, 1);
+
+        double simUs = 0.0, renderUs = 0.0;
+        long peakEnemies = 0, peakBullets = 0, peakParticles = 0;
+        for (int f = 0; f < warmup + measure; ++f) {
+            int divers = game.enemies.diveEnd - game.enemies.formEnd;
+            for (int n = 0; n < 32 && divers < game.enemies.alive / 2 && game.enemies.formEnd > 0; ++n, ++divers)
+                game.launchDive(rng.range(0, game.enemies.formEnd - 1));
+            while (game.eBullets.size() + 2 <= bullets) {
+                game.boss.x = (float)rng.range(20, SW - 20);
+                game.boss.y = (float)rng.range(40, SH / 2);
+                game.fireBossVolley();
+            }
+            for (int n = 0; n < fxPerTick; ++n)
+                game.fx.spawnExplosion(rng, (float)rng.range(0, SW), (float)rng.range(0, SH), n % 4 == 0);
+            game.player.invincible = true;
+            game.player.invTimer   = 1.f;
+
+            InputFrame in = policy.next(game, (unsigned)f);
+            auto ts = std::chrono::steady_clock::now();
+            game.update(dt, in);
+            double stepUs = elapsedUs(ts);
+            ts = std::chrono::steady_clock::now();
+            renderSoft(game, canvas);
+            double drawUs = elapsedUs(ts);
+            if (f < warmup) continue;
+            simUs += stepUs;
+            renderUs += drawUs;
+            peakEnemies   = std::max(peakEnemies, (long)game.enemies.alive);
+            peakBullets   = std::max(peakBullets, (long)game.eBullets.size());
+            peakParticles = std::max(peakParticles, (long)game.fx.particles.count);
+        }
+        simUs /= measure;
+        renderUs /= measure;
+        // Sim cost per displayed frame: simHz / 60 ticks
+        double simFrameUs = simUs * opt.simHz / 60.0;
+        bool simOver = simFrameUs > budgetUs, renderOver = renderUs > budgetUs;
+        bool frameOver = simFrameUs + renderUs > budgetUs;
+        if (simOver && !simFalls) simFalls = level;
+        if (renderOver && !renderFalls) renderFalls = level;
+        if (frameOver && !frameFalls) frameFalls = level;
+        if (game.fx.overflow && !fxCapped) fxCapped = level;
+        fxDropped += game.fx.overflow;
+        long gridHits = 0, bad = stressGridCheck(game, rng, gridHits);
+        gridBad += bad;
+        std::printf("stress: level=%d enemies=%ld bullets=%ld particles=%ld tick=%.0fus sim=%.2fms render=%.2fms frame=%.2fms%s fx_overflow=%u%s grid_check=%s hits=%ld\n",
+            level, peakEnemies, peakBullets, peakParticles, simUs, simFrameUs / 1000.0, renderUs / 1000.0,
+            (simFrameUs + renderUs) / 1000.0, frameOver ? " OVER" : "", game.fx.overflow,
+            game.fx.overflow ? " CAPPED" : "", bad ? "FAIL" : "ok", gridHits);
+    }
+    auto report = [](const char* what, int level) {
+        if (level) std::printf("stress: %s falls below 60 FPS at level %d\n", what, level);
+        else       std::printf("stress: %s holds 60 FPS at every level\n", what);
+    };
+    report("sim", simFalls);
+    report("render", renderFalls);
+    report("frame", frameFalls);
+    if (fxCapped)
+        std::printf("stress: WARNING fx pools full from level %d (%u spawns dropped), fx load is capped; raise --stress-fx-cap\n",
+            fxCapped, fxDropped);
+    if (gridBad) std::printf("stress: grid check FAILED on %ld probes\n", gridBad);
+    return gridBad ? 1 : 0;
+}
 
-        drawEnemies();
+// ─────────────────────────────────────────────────────────────
+//  BATCH SIMULATION
+// ─────────────────────────────────────────────────────────────
+struct BatchResult {
+    uint64_t seed     = 0;
+    int      round    = 0;       // round being played when the run ended
+    int      score    = 0;
+    uint32_t ticks    = 0;
+    int      deaths[(int)DeathCause::COUNT] = {};
+    bool     gameOver = false;
+    uint64_t hash     = 0;
+};
 
-        // High score
-        DrawText("HIGH SCORE", SW/2 - 50, SH/2 - 30, 16, WHITE);
-        DrawText(TextFormat("%06d", highScore), SW/2 - 36, SH/2 - 10, 20, WHITE);
+// One complete game from round 1 (or --round) until game over, the round
+// cap or the tick cap, whichever comes first.
+static BatchResult runBatchGame(const RunOptions& opt, uint64_t seed) {
+    Game game;
+    game.tuning = opt.tuning;
+    game.boot(seed);
+    game.startAtRound(std::max(1, opt.startRound));
+    PolicyDriver policy;
+    policy.start(opt.policy, seed);
+
+    const float dt   = 1.f / opt.simHz;
+    const long limit = opt.maxTicks > 0 ? opt.maxTicks : 3600L * opt.simHz;
+    BatchResult r;
+    r.seed = seed;
+    for (long t = 0; t < limit; ++t) {
+        game.update(dt, policy.next(game, (unsigned)t));
+        if (game.state == GameState::GAME_OVER) { r.gameOver = true; break; }
+        if (opt.maxRound > 0 && game.round > opt.maxRound) break;
+    }
+    r.round = game.round;
+    r.score = game.score;
+    r.ticks = game.tick;
+    for (int c = 0; c < (int)DeathCause::COUNT; ++c) r.deaths[c] = game.deaths[c];
+    r.hash  = game.tickHash;
+    return r;
+}
 
-        // Blink "INSERT COIN"
-        if (blinkOn) {
-            int iw = MeasureText("PRESS ENTER TO PLAY", 18);
-            DrawText("PRESS ENTER TO PLAY", SW/2 - iw/2, SH*3/4, 18, {200, 200, 200, 255});
+// Per-worker job deque for the work-stealing scheduler
+struct StealQueue {
+    std::mutex      m;
+    std::deque<int> jobs;
+
+    bool pop(int& job) {
+        std::lock_guard<std::mutex> lock(m);
+        if (jobs.empty()) return false;
+        job = jobs.front();
+        jobs.pop_front();
+        return true;
+    }
+    bool steal(int& job) {
+        std::lock_guard<std::mutex> lock(m);
+        if (jobs.empty()) return false;
+        job = jobs.back();
+        jobs.pop_back();
+        return true;
+    }
+};
+
+// Runs fn(0..jobCount-1) on `threads` workers. Each worker starts with a
+// contiguous block, pops from the front of its own deque and, when it runs
+// dry, steals from the back of the others. Game lengths vary wildly (early
+// death vs. round cap), so a static split would leave cores idle.
+template <class Fn>
+static void runWorkStealing(int jobCount, int threads, Fn fn) {
+    if (jobCount <= 0) return;
+    threads = std::max(1, std::min(threads, jobCount));
+    std::vector<StealQueue> queues(threads);
+    for (int j = 0; j < jobCount; ++j)
+        queues[(size_t)j * threads / jobCount].jobs.push_back(j);
+
+    auto worker = [&](int self) {
+        int job;
+        for (;;) {
+            bool got = queues[self].pop(job);
+            for (int k = 1; k < threads && !got; ++k)
+                got = queues[(self + k) % threads].steal(job);
+            // No job is ever re-queued, so empty everywhere means done
+            if (!got) return;
+            fn(job);
         }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : pool) th.join();
+}
 
-        // Controls hint
-        DrawText("MOVE: ARROWS / A-D    FIRE: SPACE", 30, SH - 36, 12, {150,150,150,255});
+static const char* policyName(InputPolicy p) {
+    switch (p) {
+        case InputPolicy::AUTOPILOT: return "autopilot";
+        case InputPolicy::RANDOM:    return "random";
+        case InputPolicy::IDLE:      return "idle";
     }
+    return "?";
+}
 
-    void drawClear() {
-        // Flash effect
-        float t = flashTimer;
-        if ((int)(t * 8) % 2 == 0) {
-            DrawRectangle(0, 0, SW, SH, {255,255,255, 60});
-        }
-        int tw = MeasureText("STAGE CLEAR!", 36);
-        DrawText("STAGE CLEAR!", SW/2 - tw/2, SH/2 - 18, 36, {100, 255, 100, 255});
-        drawHUD();
+static int runBatch(const RunOptions& opt) {
+    uint64_t span = opt.seedLast - opt.seedFirst + 1;
+    if (span == 0 || span > 100000000ull) {
+        std::fprintf(stderr, "batch: seed range too large\n");
+        return 1;
     }
-};
+    int count   = (int)span;
+    int threads = opt.threads > 0 ? opt.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<BatchResult> results(count);
+    std::atomic<int> done{0};
+    auto t0 = std::chrono::steady_clock::now();
+    runWorkStealing(count, threads, [&](int i) {
+        results[i] = runBatchGame(opt, opt.seedFirst + (uint64_t)i);
+        done.fetch_add(1, std::memory_order_relaxed);
+    });
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::FILE* csv = std::fopen(opt.csvPath, "w");
+    if (!csv) {
+        std::fprintf(stderr, "batch: could not write %s\n", opt.csvPath);
+        return 1;
+    }
+    std::fprintf(csv, "seed,policy,round,score,ticks,deaths_bullet,deaths_collision,deaths_boss,game_over,hash\n");
+    uint64_t totalTicks = 0;
+    int deathTotals[(int)DeathCause::COUNT] = {};
+    std::vector<int> roundHist;
+    std::vector<int> scores;
+    scores.reserve(count);
+    for (const auto& r : results) {
+        std::fprintf(csv, "%llu,%s,%d,%d,%u,%d,%d,%d,%d,%016llx\n",
+            (unsigned long long)r.seed, policyName(opt.policy), r.round, r.score, r.ticks,
+            r.deaths[(int)DeathCause::BULLET], r.deaths[(int)DeathCause::COLLISION],
+            r.deaths[(int)DeathCause::BOSS], r.gameOver ? 1 : 0, (unsigned long long)r.hash);
+        totalTicks += r.ticks;
+        for (int c = 0; c < (int)DeathCause::COUNT; ++c) deathTotals[c] += r.deaths[c];
+        if ((int)roundHist.size() <= r.round) roundHist.resize(r.round + 1, 0);
+        roundHist[r.round]++;
+        scores.push_back(r.score);
+    }
+    std::fclose(csv);
+
+    std::sort(scores.begin(), scores.end());
+    auto pct = [&](double p) { return scores[(size_t)std::min<double>(scores.size() - 1, p * (scores.size() - 1) + 0.5)]; };
+    double meanRound = 0.0;
+    for (const auto& r : results) meanRound += r.round;
+    meanRound /= count;
+
+    std::printf("batch: games=%d threads=%d policy=%s time=%.2fs (%.1f games/s, %.0f ticks/s)\n",
+        done.load(), threads, policyName(opt.policy), secs, secs > 0.0 ? count / secs : 0.0,
+        secs > 0.0 ? totalTicks / secs : 0.0);
+    std::printf("rounds: mean=%.2f", meanRound);
+    for (size_t rd = 1; rd < roundHist.size(); ++rd)
+        if (roundHist[rd]) std::printf(" r%zu=%d", rd, roundHist[rd]);
+    std::printf("\nscore: min=%d p10=%d p50=%d p90=%d max=%d\n",
+        scores.front(), pct(0.10), pct(0.50), pct(0.90), scores.back());
+    std::printf("deaths: bullet=%d collision=%d boss=%d\n",
+        deathTotals[(int)DeathCause::BULLET], deathTotals[(int)DeathCause::COLLISION],
+        deathTotals[(int)DeathCause::BOSS]);
+    std::printf("csv: %s\n", opt.csvPath);
+    return 0;
+}
 
 // ─────────────────────────────────────────────────────────────
 //  MAIN
 // ─────────────────────────────────────────────────────────────
-int main() {
-    srand((unsigned)time(nullptr));
+int main(int argc, char** argv) {
+    RunOptions opt;
+    if (!parseArgs(argc, argv, opt)) return 1;
+    if (opt.replayPath) return runReplay(opt);
+    if (opt.batch) return runBatch(opt);
+    if (opt.coopSim) return runCoopSim(opt);
+    if (opt.collisionCases > 0) return runCollisionCheck(opt);
+    if (opt.replayChecks > 0) return runReplayCheck(opt);
+    if (opt.stressLevels > 0) return runStress(opt);
+    if (opt.headless) return runHeadless(opt);
 
     SetConfigFlags(FLAG_WINDOW_RESIZABLE | FLAG_VSYNC_HINT);
     InitWindow(SW, SH, "GALAXIAN");
-    SetTargetFPS(FPS_TARGET);
-    SetRandomSeed((unsigned)time(nullptr));
-
     // Auto-scale initial window to fit ~85% of monitor height
     int mon = GetCurrentMonitor();
     int monH = GetMonitorHeight(mon);
@@ -1638,16 +5798,54 @@ int main() {
     int windowedH = SH * initScale;
     SetWindowSize(windowedW, windowedH);
 
+    // Render at the display's refresh; the simulation rate is independent
+    int refresh = GetMonitorRefreshRate(mon);
+    SetTargetFPS(refresh > 0 ? refresh : FPS_TARGET);
+
     gSprites.load();
+    gHud.load();
     RenderTexture2D scene = LoadRenderTexture(SW, SH);
     SetTextureFilter(scene.texture, TEXTURE_FILTER_POINT);
 
+    // Both netplay peers must boot the same game: default to a fixed seed
+    const bool online = opt.udpLocal > 0;
+    uint64_t seed = online && !opt.hasSeed ? 1 : opt.resolveSeed();
     Game game;
-    game.stars.init();
     // Build attract-mode formation
-    game.buildFormation();
+    if (!setupGame(game, opt, seed)) {
+        CloseWindow();
+        return 1;
+    }
+
+    RollbackSession net;
+#if GX_HAS_UDP
+    UdpTransport udp;
+    if (online) {
+        if (!udp.open(opt.udpLocal, opt.udpRemote)) {
+            TraceLog(LOG_ERROR, "No se pudo abrir el puerto UDP %d", opt.udpLocal);
+            CloseWindow();
+            return 1;
+        }
+        net.start(game, udp, opt.coopSlot, opt.simHz);
+    }
+#endif
+    // Screen shake runs per displayed frame, so it gets its own stream and
+    // leaves the game's (tick-driven) streams alone
+    RngStream shakeRng = {GameRng::streamKey(seed, GameRng::RENDER), 0};
+
+    SimClock clock;
+    clock.setRate(opt.simHz);
+    InputFrame pending, pending2;
+
+    Replay rec;
+    rec.start(seed, opt.simHz, game.tuning, opt.startsFromBoot() ? nullptr : &game);
+    HashTrace trace;
+    openTrace(trace, opt);
+
+    bool showDrawStats = false;
 
     while (!WindowShouldClose()) {
+        if (IsKeyPressed(KEY_F3)) showDrawStats = !showDrawStats;
         if (IsKeyPressed(KEY_F11)) {
             if (IsWindowFullscreen()) {
                 ToggleFullscreen();
@@ -1659,11 +5857,37 @@ int main() {
             }
         }
 
-        float dt = GetFrameTime();
-        game.update(dt);
+        // Held keys apply to every tick of this frame; press edges are
+        // latched until a tick consumes them so none are lost or doubled.
+        auto latch = [](InputFrame& p, const InputFrame& polled) {
+            p.left   = polled.left;
+            p.right  = polled.right;
+            p.fire  |= polled.fire;
+            p.start |= polled.start;
+        };
+        // Local co-op splits the keyboard into two seats
+        const bool twoSeats = opt.coop && !online;
+        latch(pending, twoSeats ? readSeatInput(0) : readInput());
+        if (twoSeats) latch(pending2, readSeatInput(1));
+
+        int ticks = clock.advance(GetFrameTime());
+        for (int i = 0; i < ticks; ++i) {
+            if (online) {
+                // Stalled waiting for the peer: keep the input for next frame
+                if (!net.advance(pending)) break;
+            } else {
+                game.update((float)clock.step, pending, pending2);
+            }
+            if (opt.recordPath) rec.record(pending, game);
+            trace.write(game);
+            pending.fire  = pending2.fire  = false;
+            pending.start = pending2.start = false;
+        }
+        if (online && ticks == 0) net.pump();
 
+        game.refreshHud();
         BeginTextureMode(scene);
-        game.draw();
+        game.draw(clock.alpha());
         EndTextureMode();
 
         BeginDrawing();
@@ -1676,19 +5900,30 @@ int main() {
         float drawH = std::round(SH * scale);
         float drawX = std::floor(((float)renderW - drawW) * 0.5f);
         float drawY = std::floor(((float)renderH - drawH) * 0.5f);
-        if (gShake > 0.5f) {
-            int s = (int)(gShake * scale);
-            drawX += (float)GetRandomValue(-s, s);
-            drawY += (float)GetRandomValue(-s, s);
+        if (game.fx.shake > 0.5f) {
+            int s = (int)(game.fx.shake * scale);
+            drawX += (float)shakeRng.range(-s, s);
+            drawY += (float)shakeRng.range(-s, s);
         }
         Rectangle src = {0.f, 0.f, (float)SW, -(float)SH};
         Rectangle dst = {drawX, drawY, drawW, drawH};
         DrawTexturePro(scene.texture, src, dst, {0.f, 0.f}, 0.f, WHITE);
+        if (showDrawStats) {
+            const RenderQueue::Stats& ds = gDraw.last;
+            DrawText(TextFormat("draw: %d cmds  %d groups  %d flushes  (%d saved)  hud: %d renders",
+                ds.commands, ds.groups, ds.flushes, ds.saved(), gHud.renders), 8, 8, 10, {120, 255, 120, 255});
+        }
         EndDrawing();
     }
 
+    if (opt.recordPath && !rec.save(opt.recordPath))
+        TraceLog(LOG_ERROR, "No se pudo guardar el replay: %s", opt.recordPath);
+
     UnloadRenderTexture(scene);
+    gHud.unload();
     gSprites.unload();
     CloseWindow();
     return 0;
 }
+
+#endif // GALAXIAN_GYM